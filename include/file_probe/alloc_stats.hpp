@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include "file_probe/timings.hpp"
+
+namespace file_probe {
+    struct AllocationStats {
+        std::uint64_t allocations = 0;
+        std::uint64_t frees = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    // True in `make instrumented` builds, which replace the global operator
+    // new/delete; otherwise every counter stays zero.
+    bool allocation_tracking_enabled();
+
+    // Counters for the calling thread, attributed to the innermost active
+    // phase (so unlike timings they are exclusive); std::nullopt selects
+    // allocations made outside any phase.
+    AllocationStats thread_allocation_stats(std::optional<Phase> phase);
+}
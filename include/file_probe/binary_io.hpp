@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace file_probe {
+    // Little-endian encoder for the on-disk formats (shard partials and the
+    // directory cache), so files move freely between hosts.
+    class BinaryWriter {
+    public:
+        void put_u8(std::uint8_t value);
+        void put_u32(std::uint32_t value);
+        void put_u64(std::uint64_t value);
+        void put_double(double value);
+        void put_string(const std::string& value);
+        void put_optional_string(const std::optional<std::string>& value);
+        void put_bytes(const void* data, std::size_t length);
+
+        const std::string& data() const { return buffer_; }
+
+    private:
+        std::string buffer_;
+    };
+
+    // Bounds-checked decoder; any short or implausible field marks the whole
+    // input as corrupt instead of throwing.
+    class BinaryReader {
+    public:
+        explicit BinaryReader(const std::string& data) : data_(data) {}
+
+        bool ok() const { return ok_; }
+        void fail() { ok_ = false; }
+        bool at_end() const { return position_ == data_.size(); }
+
+        std::uint8_t get_u8();
+        std::uint32_t get_u32();
+        std::uint64_t get_u64();
+        double get_double();
+        // Element counts are checked against the remaining bytes so a corrupt
+        // length cannot trigger a huge allocation.
+        std::size_t get_count(std::size_t min_element_size);
+        std::string get_string();
+        std::optional<std::string> get_optional_string();
+        void get_bytes(void* out, std::size_t length);
+
+    private:
+        bool require(std::size_t length);
+
+        const std::string& data_;
+        std::size_t position_ = 0;
+        bool ok_ = true;
+    };
+
+    std::optional<std::string> read_binary_file(const std::string& path);
+    // Writes to "<path>.tmp" and renames it into place so readers never see a
+    // partially written file.
+    bool write_binary_file(const std::string& path, const std::string& data, std::string& error);
+    // Same, writing the parts back to back without joining them in memory.
+    bool write_binary_file(const std::string& path, const std::vector<std::string_view>& parts, std::string& error);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace file_probe {
+    // Lease on a large, page-aligned read buffer; returned to the pool on destruction.
+    class ReadBuffer {
+    public:
+        ReadBuffer() = default;
+        ReadBuffer(std::uint8_t* data, std::size_t size);
+        ReadBuffer(ReadBuffer&& other) noexcept;
+        ReadBuffer& operator=(ReadBuffer&& other) noexcept;
+        ReadBuffer(const ReadBuffer&) = delete;
+        ReadBuffer& operator=(const ReadBuffer&) = delete;
+        ~ReadBuffer();
+
+        std::uint8_t* data() const { return data_; }
+        std::size_t size() const { return size_; }
+        explicit operator bool() const { return data_ != nullptr; }
+
+    private:
+        void release();
+
+        std::uint8_t* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+
+    ReadBuffer acquire_read_buffer();
+}
@@ -3,5 +3,5 @@
 #include "file_probe/types.hpp"
 
 namespace file_probe {
-    FileReport collect_file_report(const std::filesystem::path& path);
+    FileReport collect_file_report(const std::filesystem::path& path, const ProbeOptions& options = {});
 } 
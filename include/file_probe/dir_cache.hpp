@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    // Size, count and symlink totals for a directory tree, reusing per-directory
+    // aggregates from cache_path. A directory whose (dev, ino, mtime, ctime) is
+    // unchanged is not read again; only its subdirectories are stat'ed. Files
+    // rewritten in place do not touch their directory and so are not noticed.
+    DirectoryDetail collect_cached_directory_detail(const std::filesystem::path& path, const std::string& cache_path,
+                                                    std::vector<std::string>& warnings);
+}
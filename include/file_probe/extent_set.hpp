@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    // Multiset of physical extents keyed by (device, physical offset). Batches are
+    // sorted, identical extents coalesced, and spilled to temporary files as
+    // sorted runs; finish() sweeps a k-way merge of all runs to split physical
+    // bytes into those referenced once and those shared by several extents.
+    class ExtentSet {
+    public:
+        explicit ExtentSet(std::size_t max_buffered = kDefaultMaxBuffered);
+        ExtentSet(const ExtentSet&) = delete;
+        ExtentSet& operator=(const ExtentSet&) = delete;
+
+        void add(std::uint64_t device, std::uint64_t physical, std::uint64_t length);
+        void add_unmapped(std::uint64_t length);
+        PhysicalUsage finish();
+
+        struct Record {
+            std::uint64_t device;
+            std::uint64_t start;
+            std::uint64_t end;
+            std::uint64_t count;
+        };
+
+    private:
+        struct FileCloser {
+            void operator()(std::FILE* file) const noexcept {
+                if (file) {
+                    std::fclose(file);
+                }
+            }
+        };
+
+        static constexpr std::size_t kDefaultMaxBuffered = 1 << 20;
+
+        void compact();
+        void spill();
+
+        std::size_t max_buffered_;
+        std::vector<Record> buffer_;
+        std::vector<std::unique_ptr<std::FILE, FileCloser>> runs_;
+        PhysicalUsage usage_;
+    };
+}
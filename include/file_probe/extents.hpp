@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <optional>
+#include <filesystem>
+#include "file_probe/types.hpp"
+#include "file_probe/extent_set.hpp"
+
+namespace file_probe {
+    std::optional<ExtentInfo> collect_extent_info(int fd, uintmax_t size, std::string& error);
+    // `fd` is the open file (or -1, counted as unmapped); `path` only labels
+    // the most fragmented file.
+    void accumulate_extents(int fd, const std::filesystem::path& path, uintmax_t size, ExtentSummary& summary);
+    void accumulate_physical_extents(int fd, std::uint64_t device, uintmax_t size, ExtentSet& set);
+}
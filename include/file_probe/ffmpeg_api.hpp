@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+}
+
+namespace file_probe {
+    // FFmpeg entry points used by the media backend. Built with
+    // FILE_PROBE_FFMPEG_DLOPEN the libraries are loaded on first use, so runs
+    // that never probe media skip FFmpeg's relocations and constructors;
+    // otherwise the table points at the linked symbols.
+    struct FfmpegApi {
+        decltype(&::avformat_alloc_context) alloc_context;
+        decltype(&::avformat_free_context) free_context;
+        decltype(&::avformat_open_input) open_input;
+        decltype(&::avformat_find_stream_info) find_stream_info;
+        decltype(&::avformat_close_input) close_input;
+        decltype(&::avcodec_get_name) codec_name;
+    };
+
+    // Returns nullptr and sets error when the libraries cannot be loaded.
+    const FfmpegApi* ffmpeg_api(std::string& error);
+}
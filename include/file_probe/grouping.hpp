@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include "file_probe/types.hpp"
+#include "file_probe/query.hpp"
+
+namespace file_probe {
+    std::optional<GroupKey> parse_group_key(const std::string& value);
+    const char* group_key_name(GroupKey key);
+    std::string group_value(GroupKey key, EntryContext& entry);
+
+    // Aggregates keyed by group value. Each walker owns a table; tables from
+    // several walkers are combined with merge() before the summary is built.
+    class GroupTable {
+    public:
+        void add(const std::string& key, uintmax_t size, std::time_t mtime);
+        void add(const GroupRow& row);
+        void merge(const GroupTable& other);
+        GroupSummary summary(GroupKey key) const;
+
+    private:
+        std::unordered_map<std::string, GroupRow> rows_;
+    };
+}
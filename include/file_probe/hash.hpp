@@ -1,8 +1,43 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
 
 namespace file_probe {
-    std::optional<std::string> compute_sha256(const std::filesystem::path& path);
+    using Sha256Digest = std::array<std::uint8_t, 32>;
+
+    // Incremental SHA-256 for callers that hash structured records rather
+    // than whole files.
+    class Sha256 {
+    public:
+        Sha256();
+
+        void update(const std::uint8_t* data, std::size_t length);
+        Sha256Digest finalize();
+
+    private:
+        static constexpr std::size_t kBlockSize = 64;
+
+        void reset();
+        void process_block(const std::uint8_t* block);
+
+        std::array<std::uint32_t, 8> state_ {};
+        std::array<std::uint8_t, kBlockSize> buffer_ {};
+        std::uint64_t bit_count_ = 0;
+        std::size_t buffer_size_ = 0;
+    };
+
+    std::string to_hex(const Sha256Digest& digest);
+    // `bytes_hashed`, when given, receives the number of bytes actually read,
+    // which differs from st_size for pseudo-files and files that are growing.
+    std::optional<Sha256Digest> compute_sha256_digest(const std::filesystem::path& path,
+                                                      uintmax_t* bytes_hashed = nullptr);
+    std::optional<std::string> compute_sha256(const std::filesystem::path& path, uintmax_t* bytes_hashed = nullptr);
+    // Same, hashing an already open file from offset 0.
+    std::optional<Sha256Digest> compute_sha256_digest(int fd, uintmax_t* bytes_hashed = nullptr);
+    std::optional<std::string> compute_sha256(int fd, uintmax_t* bytes_hashed = nullptr);
+    std::string sha256_hex(const std::uint8_t* data, std::size_t length);
 }
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "file_probe/hash.hpp"
+
+namespace file_probe {
+    // Read-only view of a binary known-hash list mapped with mmap: a blocked
+    // Bloom filter (one 64-byte block per probe) in front of sorted digests
+    // searched by interpolation, so a miss usually costs one cache line and a
+    // hit a handful of probes even for hundreds of millions of entries.
+    class HashSet {
+    public:
+        ~HashSet();
+
+        HashSet(const HashSet&) = delete;
+        HashSet& operator=(const HashSet&) = delete;
+
+        static std::shared_ptr<const HashSet> open(const std::string& path, std::string& error);
+
+        bool contains(const Sha256Digest& digest) const;
+        // Accepts a 64-character hex digest; anything else never matches.
+        bool contains_hex(std::string_view hex) const;
+        std::size_t size() const { return count_; }
+
+    private:
+        HashSet() = default;
+
+        bool maybe_contains(const Sha256Digest& digest) const;
+
+        void* mapping_ = nullptr;
+        std::size_t mapping_size_ = 0;
+        const std::uint8_t* bloom_ = nullptr;
+        std::uint64_t bloom_blocks_ = 0;
+        const std::uint8_t* digests_ = nullptr;
+        std::size_t count_ = 0;
+    };
+
+    struct HashSetBuildResult {
+        std::size_t digests = 0;
+        std::size_t duplicates = 0;
+        std::size_t invalid_lines = 0;
+    };
+
+    // Converts text lists (one hex SHA-256 per line, sha256sum output is
+    // accepted, blank lines and '#' comments skipped) into the binary format.
+    bool build_hashset(const std::vector<std::string>& inputs, const std::string& output,
+                       HashSetBuildResult& result, std::string& error);
+}
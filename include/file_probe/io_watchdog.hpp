@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <string>
+#include <functional>
+#include <sys/stat.h>
+#include <unordered_map>
+
+namespace file_probe {
+    // Issues filesystem calls for each device from that device's own worker
+    // thread so a hard-mounted filesystem that stops answering cannot freeze
+    // the walk. A call that outlives the timeout marks the device stalled; its
+    // worker is abandoned (it may sit in uninterruptible sleep) and every later
+    // call for that device fails fast.
+    class IoWatchdog {
+    public:
+        enum class Outcome {
+            Ok,
+            Failed,
+            Stalled
+        };
+
+        // Reports success by returning true. An abandoned call still runs to
+        // completion on its worker, so it must own everything it touches
+        // (copies, or shared_ptrs to results and open directories).
+        using Call = std::function<bool()>;
+
+        explicit IoWatchdog(std::chrono::milliseconds timeout);
+        ~IoWatchdog();
+
+        IoWatchdog(const IoWatchdog&) = delete;
+        IoWatchdog& operator=(const IoWatchdog&) = delete;
+
+        Outcome run(dev_t device, Call call);
+        // For calls whose device is not known up front, such as resolving a
+        // symlink target: runs on a spare worker tied to no device. A stall
+        // abandons only that worker; the next call gets a fresh one.
+        Outcome run_unbound(Call call);
+        bool is_stalled(dev_t device) const;
+
+    private:
+        struct Worker;
+
+        Outcome dispatch(std::shared_ptr<Worker>& worker, Call call);
+
+        std::chrono::milliseconds timeout_;
+        std::unordered_map<dev_t, std::shared_ptr<Worker>> workers_;
+        std::shared_ptr<Worker> unbound_;
+    };
+
+    // Device numbers of mounted filesystems keyed by absolute mount point, from
+    // /proc/self/mountinfo. A mount point is answered by the filesystem mounted
+    // on it, not by the one holding its parent directory.
+    std::unordered_map<std::string, dev_t> mount_point_devices();
+}
@@ -1,4 +1,7 @@
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -10,7 +13,20 @@ namespace file_probe {
 
     std::optional<std::string> image_resolution(const std::filesystem::path& path);
     std::optional<std::string> image_metadata(const std::filesystem::path& path);
-    std::optional<std::string> media_resolution(const std::filesystem::path& path);
-    std::optional<std::string> media_metadata(const std::filesystem::path& path);
-    std::optional<std::string> media_duration(const std::filesystem::path& path);
+    std::optional<std::string> image_resolution(const std::uint8_t* data, std::size_t length);
+    std::optional<std::string> image_metadata(const std::uint8_t* data, std::size_t length);
+
+    struct MediaProbe {
+        bool opened = false;
+        bool timed_out = false;
+        // Set when the FFmpeg backend could not be loaded.
+        std::string error;
+        std::optional<std::string> resolution;
+        std::optional<std::string> metadata;
+        std::optional<std::string> duration;
+    };
+
+    // Opens the container once and reads everything from it. A positive
+    // timeout bounds the whole probe through FFmpeg's interrupt callback.
+    MediaProbe probe_media(const std::filesystem::path& path, std::chrono::milliseconds timeout);
 }
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace file_probe {
+    // Large write-through buffer over a file descriptor, so record-oriented
+    // output costs one write(2) per buffer instead of one per field.
+    class OutputBuffer {
+    public:
+        explicit OutputBuffer(int fd, std::size_t capacity = 1 << 16);
+        ~OutputBuffer();
+
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+        void append(std::string_view text);
+        void append(char c);
+        void append_number(std::uintmax_t value);
+        void append_padding(char c, std::size_t count);
+
+        // Returns false once a write has failed (e.g. EPIPE from `head`);
+        // later output is discarded.
+        bool flush();
+        bool ok() const { return ok_; }
+
+    private:
+        void reserve(std::size_t length);
+
+        int fd_;
+        std::size_t capacity_;
+        std::string buffer_;
+        bool ok_ = true;
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include "file_probe/types.hpp"
+#include "file_probe/output_buffer.hpp"
+
+namespace file_probe {
+    enum class TemplateEscape {
+        Raw,
+        Shell,
+        Csv
+    };
+
+    enum class TemplateField : std::uint8_t {
+        Path,
+        Name,
+        Type,
+        Size,
+        SizeHuman,
+        Sha256,
+        Mode,
+        Owner,
+        Group,
+        Atime,
+        Mtime,
+        Ctime,
+        Target,
+        Resolution,
+        Duration,
+        Metadata,
+        Files,
+        Dirs
+    };
+
+    std::optional<TemplateEscape> parse_template_escape(const std::string& value);
+
+    // A --format template compiled into literal and field ops. Rendering
+    // appends straight into the output buffer; escaping applies to field
+    // values only, and every record ends with a newline.
+    class OutputTemplate {
+    public:
+        struct Op {
+            bool literal = true;
+            TemplateField field = TemplateField::Path;
+            std::size_t offset = 0;
+            std::size_t length = 0;
+        };
+
+        OutputTemplate(std::string literals, std::vector<Op> ops, TemplateEscape escape)
+            : literals_(std::move(literals)), ops_(std::move(ops)), escape_(escape) {}
+
+        void render(const FileReport& report, OutputBuffer& out) const;
+        // Entries matched by --where only carry a path, type and size; other
+        // fields render empty.
+        void render(const MatchedEntry& entry, OutputBuffer& out) const;
+        bool uses(TemplateField field) const;
+
+    private:
+        template <typename Source>
+        void execute(const Source& source, OutputBuffer& out) const;
+
+        std::string literals_;
+        std::vector<Op> ops_;
+        TemplateEscape escape_;
+    };
+
+    std::shared_ptr<const OutputTemplate> compile_template(const std::string& text, TemplateEscape escape, std::string& error);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace file_probe {
+    enum class PerfEvent : std::size_t {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        PageFaults,
+        Count
+    };
+
+    constexpr std::size_t kPerfEventCount = static_cast<std::size_t>(PerfEvent::Count);
+
+    const char* perf_event_name(PerfEvent event);
+
+    using PerfSample = std::array<std::uint64_t, kPerfEventCount>;
+
+    // Per-thread perf_event_open counters for the calling thread, user space
+    // only so they work under the default perf_event_paranoid setting. Each
+    // event is opened on its own, so a VM without a PMU still gets page faults.
+    class PerfCounters {
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        // Returns a warning naming the events that could not be opened.
+        std::optional<std::string> open();
+        bool available(PerfEvent event) const;
+        PerfSample read() const;
+
+    private:
+        std::array<int, kPerfEventCount> fds_;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include <sys/stat.h>
+#include "file_probe/small_file.hpp"
+
+namespace file_probe {
+    // Per-entry view used while evaluating a query. Every field is computed on
+    // first use, so predicates on names never stat and only entries that pass
+    // the cheap predicates get classified or hashed. A walker supplies the
+    // lstat it already has and a loader that opens the entry relative to its
+    // parent directory; without one the entry is stat'ed and read by path.
+    class EntryContext {
+    public:
+        using Classifier = std::function<std::string(EntryContext&)>;
+        using Loader = std::function<const SmallFile*()>;
+        // Hashes a file too large to load; defaults to streaming its fd.
+        using Hasher = std::function<std::optional<std::string>(const SmallFile&)>;
+
+        EntryContext(std::filesystem::path path, std::size_t depth, Classifier classifier, Loader loader = nullptr,
+                     Hasher hasher = nullptr);
+
+        const std::filesystem::path& path() const { return path_; }
+        std::size_t depth() const { return depth_; }
+        const std::string& name();
+        const std::string& extension();
+        const struct stat* info();
+        void set_info(const struct stat& info);
+        // The opened (and, when small, loaded) regular file; null otherwise.
+        const SmallFile* contents();
+        const std::string& type();
+        bool has_type() const { return type_.has_value(); }
+        const std::string& owner();
+        const std::string& group();
+        const std::optional<std::string>& sha256();
+
+    private:
+        std::filesystem::path path_;
+        std::size_t depth_;
+        Classifier classifier_;
+        Loader loader_;
+        Hasher hasher_;
+
+        std::optional<std::string> name_;
+        std::optional<std::string> extension_;
+        std::optional<bool> has_info_;
+        struct stat info_ {};
+        std::optional<std::string> type_;
+        std::optional<std::string> owner_;
+        std::optional<std::string> group_;
+        bool contents_done_ = false;
+        const SmallFile* contents_ = nullptr;
+        std::optional<SmallFile> owned_contents_;
+        bool sha256_done_ = false;
+        std::optional<std::string> sha256_;
+    };
+
+    class Query {
+    public:
+        using Predicate = std::function<bool(EntryContext&)>;
+
+        explicit Query(Predicate predicate) : predicate_(std::move(predicate)) {}
+
+        bool matches(EntryContext& entry) const { return predicate_(entry); }
+
+    private:
+        Predicate predicate_;
+    };
+
+    std::shared_ptr<const Query> compile_query(const std::string& text, std::string& error);
+}
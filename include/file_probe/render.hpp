@@ -1,7 +1,15 @@
 #pragma once
 #include "file_probe/types.hpp"
+#include "file_probe/timings.hpp"
+#include "file_probe/output_template.hpp"
 
 namespace file_probe {
     void render_text(const FileReport& report);
     void render_json(const FileReport& report);
+    // One line per report, or per matched entry when --where listed matches.
+    // ls -l style columns; entries matched by --where get one row each.
+    void render_table(const FileReport& report, bool fixed_widths);
+    void render_template(const FileReport& report, const OutputTemplate& output_template);
+    void render_timings_text(const PhaseRecorder& recorder);
+    void render_timings_json(const PhaseRecorder& recorder);
 }
@@ -0,0 +1,12 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    std::optional<std::vector<int>> parse_cpu_list(const std::string& value);
+    std::optional<IoPriority> parse_io_priority(const std::string& value);
+    std::optional<int> parse_numa_node(const std::string& value);
+    std::vector<std::string> apply_scheduling(const SchedulingOptions& options);
+}
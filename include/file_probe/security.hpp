@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    SecurityInfo collect_security_info(int fd, mode_t mode, std::vector<std::string>& warnings);
+    // `fd` may be an O_PATH descriptor (special files, unreadable entries) or
+    // -1, in which case only the mode bits are counted.
+    void accumulate_security(int fd, mode_t mode, SecuritySummary& summary);
+}
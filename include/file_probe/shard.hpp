@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    // Parses "I/N" with 0 <= I < N.
+    std::optional<ShardSpec> parse_shard(const std::string& value);
+
+    // Entries are partitioned by their first two path components below the
+    // scan root, so a single huge top-level directory still spreads across
+    // every shard.
+    bool shard_owns(const ShardSpec& shard, const std::string& key);
+
+    // Partials hold the mergeable parts of a directory report; physical usage
+    // is excluded because shared extents cannot be deduplicated across them.
+    bool write_partial(const std::string& path, const FileReport& report, const ShardSpec& shard, std::string& error);
+    std::optional<FileReport> merge_partials(const std::vector<std::string>& paths, std::string& error);
+}
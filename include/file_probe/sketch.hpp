@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace file_probe {
+    std::uint64_t hash64(const void* data, std::size_t length, std::uint64_t seed = 0);
+
+    // HyperLogLog with 2^14 registers (~0.8% standard error, 16 KiB).
+    class HyperLogLog {
+    public:
+        static constexpr unsigned kPrecision = 14;
+        static constexpr std::size_t kRegisterCount = std::size_t(1) << kPrecision;
+
+        void add(std::uint64_t hash);
+        void merge(const HyperLogLog& other);
+        std::uint64_t estimate() const;
+
+        const std::array<std::uint8_t, kRegisterCount>& registers() const { return registers_; }
+        std::array<std::uint8_t, kRegisterCount>& registers() { return registers_; }
+
+    private:
+        std::array<std::uint8_t, kRegisterCount> registers_ {};
+    };
+
+    // KLL quantile sketch; compactors shrink geometrically towards level 0 so
+    // memory stays O(k) regardless of how many values are added.
+    class KllSketch {
+    public:
+        explicit KllSketch(std::size_t k = 200);
+
+        void add(double value);
+        void merge(const KllSketch& other);
+        double quantile(double rank) const;
+        std::uint64_t count() const { return count_; }
+
+        const std::vector<std::vector<double>>& levels() const { return levels_; }
+        void restore(std::uint64_t count, std::vector<std::vector<double>> levels);
+
+    private:
+        std::size_t capacity(std::size_t level) const;
+        void compress();
+
+        std::size_t k_;
+        std::uint64_t count_ = 0;
+        bool compaction_parity_ = false;
+        std::vector<std::vector<double>> levels_;
+    };
+
+    // Count-Min sketch with a small candidate list for approximate top-k keys.
+    class CountMinSketch {
+    public:
+        static constexpr std::size_t kDepth = 4;
+        static constexpr std::size_t kWidth = 2048;
+        static constexpr std::size_t kCandidates = 32;
+
+        void add(const std::string& key, std::uint64_t amount = 1);
+        void merge(const CountMinSketch& other);
+        std::uint64_t estimate(const std::string& key) const;
+        std::vector<std::pair<std::string, std::uint64_t>> top(std::size_t limit) const;
+
+        const std::vector<std::uint32_t>& counters() const { return counters_; }
+        std::vector<std::uint32_t>& counters() { return counters_; }
+        const std::vector<std::string>& candidates() const { return candidates_; }
+        void add_candidate(const std::string& key);
+
+    private:
+        std::vector<std::uint32_t> counters_ = std::vector<std::uint32_t>(kDepth * kWidth, 0);
+        std::vector<std::string> candidates_;
+    };
+
+    struct SketchSet {
+        std::uint64_t hashed_files = 0;
+        HyperLogLog distinct_content;
+        KllSketch size_bytes;
+        KllSketch age_days;
+        CountMinSketch extensions;
+
+        void merge(const SketchSet& other);
+    };
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <sys/stat.h>
+#include "file_probe/buffer_pool.hpp"
+
+namespace file_probe {
+    constexpr std::size_t kSmallFileLimit = 64 * 1024;
+
+    // Owns an open file descriptor; closed on destruction.
+    class FileHandle {
+    public:
+        FileHandle() = default;
+        explicit FileHandle(int fd) : fd_(fd) {}
+        FileHandle(FileHandle&& other) noexcept;
+        FileHandle& operator=(FileHandle&& other) noexcept;
+        FileHandle(const FileHandle&) = delete;
+        FileHandle& operator=(const FileHandle&) = delete;
+        ~FileHandle();
+
+        int get() const { return fd_; }
+        explicit operator bool() const { return fd_ >= 0; }
+
+    private:
+        int fd_ = -1;
+    };
+
+    struct SmallFile {
+        struct stat info {};
+        bool loaded = false;
+        std::size_t size = 0;
+        ReadBuffer buffer;
+        // Stays open for fd-based follow-ups: security attributes, extents and
+        // streaming the files too large to load.
+        FileHandle fd;
+
+        const std::uint8_t* data() const { return buffer.data(); }
+    };
+
+    // openat + fstat without reading; `info` is valid whenever a value is
+    // returned. Symlinks fail to open unless `follow_links`.
+    std::optional<SmallFile> open_small_file(int dirfd, const char* name, bool follow_links = false);
+
+    // Reads an opened file to EOF into a pooled buffer when it is a regular
+    // file of at most `limit` bytes (one read, plus the one that sees EOF).
+    // Returns whether the contents were loaded.
+    bool load_small_file(SmallFile& file, std::size_t limit = kSmallFileLimit);
+
+    // open_small_file followed by load_small_file; a value is returned even
+    // if the contents were too large to load.
+    std::optional<SmallFile> read_small_file(int dirfd, const char* name, std::size_t limit = kSmallFileLimit,
+                                             bool follow_links = false);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    // False unless built with `make SQLITE=1`.
+    bool sqlite_inventory_available();
+
+    // Appends the report to an SQLite inventory as a new run: the probed
+    // path and any entries matched by --where go to `files`, directory totals
+    // to `directories`, media details to `media_streams` and warnings to
+    // `warnings`, all keyed by run_id.
+    bool write_sqlite_inventory(const std::string& path, const FileReport& report, std::string& error);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "file_probe/output_buffer.hpp"
+
+namespace file_probe {
+    struct TableColumn {
+        std::size_t fixed_width = 0;
+        bool right_align = false;
+    };
+
+    // ls -l style aligned rows. Widths come from a lookahead window of
+    // buffered rows and only ever grow, so output streams without reflowing
+    // earlier lines; with fixed widths rows are written immediately.
+    class TableWriter {
+    public:
+        static constexpr std::size_t kLookahead = 1024;
+
+        TableWriter(OutputBuffer& out, std::vector<TableColumn> columns, bool fixed_widths);
+        ~TableWriter();
+
+        // `color` wraps a cell in an ANSI sequence without affecting its width.
+        void add_row(std::vector<std::string> cells, const char* color = nullptr);
+        void finish();
+
+    private:
+        struct Row {
+            std::vector<std::string> cells;
+            const char* color = nullptr;
+        };
+
+        void write_row(const Row& row);
+        void drain();
+
+        OutputBuffer& out_;
+        std::vector<TableColumn> columns_;
+        std::vector<std::size_t> widths_;
+        bool fixed_widths_;
+        std::vector<Row> pending_;
+    };
+}
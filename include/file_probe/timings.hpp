@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include "file_probe/perf_counters.hpp"
+
+namespace file_probe {
+    enum class Phase : std::size_t {
+        Metadata,
+        Classify,
+        Hash,
+        Media,
+        Walk,
+        Render,
+        Count
+    };
+
+    constexpr std::size_t kPhaseCount = static_cast<std::size_t>(Phase::Count);
+
+    const char* phase_name(Phase phase);
+
+    struct ReadProfile {
+        std::string filesystem;
+        std::size_t block_size = 0;
+        std::size_t initial_chunk = 0;
+        std::size_t final_chunk = 0;
+        std::size_t readahead = 0;
+        uintmax_t bytes_read = 0;
+        double seconds = 0.0;
+    };
+
+    class PhaseRecorder {
+    public:
+        void add(Phase phase, std::chrono::nanoseconds elapsed);
+        std::chrono::nanoseconds elapsed(Phase phase) const;
+
+        void set_read_profile(ReadProfile profile);
+        const std::optional<ReadProfile>& read_profile() const { return read_profile_; }
+
+        // Counters must belong to the thread the recorder is installed on.
+        void attach_perf_counters(const PerfCounters* counters) { perf_counters_ = counters; }
+        const PerfCounters* perf_counters() const { return perf_counters_; }
+        void add_counters(Phase phase, const PerfSample& start, const PerfSample& end);
+        const PerfSample& counters(Phase phase) const;
+
+    private:
+        std::array<std::chrono::nanoseconds, kPhaseCount> elapsed_ {};
+        std::optional<ReadProfile> read_profile_;
+        const PerfCounters* perf_counters_ = nullptr;
+        std::array<PerfSample, kPhaseCount> counters_ {};
+    };
+
+    // The recorder is per thread; without one installed, phase scopes cost a pointer check.
+    void install_phase_recorder(PhaseRecorder* recorder);
+    PhaseRecorder* active_phase_recorder();
+
+    // Innermost ScopedPhase open on the calling thread, tracked whether or not
+    // a recorder is installed.
+    std::optional<Phase> innermost_phase();
+
+    class ScopedPhase {
+    public:
+        explicit ScopedPhase(Phase phase);
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+        ~ScopedPhase();
+
+    private:
+        Phase phase_;
+        std::size_t outer_phase_;
+        PhaseRecorder* recorder_;
+        std::chrono::steady_clock::time_point start_;
+        PerfSample start_counters_ {};
+    };
+}
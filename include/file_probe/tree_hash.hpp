@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "file_probe/types.hpp"
+
+namespace file_probe {
+    // Merkle digest of a directory tree. Each directory hashes its entries in
+    // byte order of name as (name, mode, size, digest) records, where a
+    // subdirectory's digest is its own tree digest and a symlink's is the
+    // hash of its target (links are never followed). Sibling subtrees are
+    // hashed concurrently; the result does not depend on scheduling.
+    //
+    // This walk replaces the size walk: the totals come from the same listing
+    // and count links as links, and --follow, --cache and --stall-timeout do
+    // not apply to it.
+    DirectoryDetail collect_tree_hash_detail(const std::filesystem::path& root, std::vector<std::string>& warnings);
+}
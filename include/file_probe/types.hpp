@@ -1,15 +1,101 @@
 #pragma once
+#include <ctime>
+#include <chrono>
+#include <memory>
 #include <filesystem>
 #include <optional>
 #include <string>
 #include <vector>
+#include <utility>
+#include "file_probe/sketch.hpp"
 
 namespace file_probe {
+    class Query;
+    class OutputTemplate;
+    class HashSet;
+
+    enum class IoPriorityClass {
+        BestEffort,
+        Idle
+    };
+
+    struct IoPriority {
+        IoPriorityClass io_class = IoPriorityClass::BestEffort;
+        int level = 4;
+    };
+
+    constexpr int kNumaNodeAuto = -1;
+
+    struct SchedulingOptions {
+        std::optional<int> nice;
+        std::optional<IoPriority> io_priority;
+        std::vector<int> cpus;
+        std::optional<int> numa_node;
+    };
+
+    enum class GroupKey {
+        Owner,
+        Group,
+        Type,
+        Extension,
+        MtimeMonth,
+        Depth
+    };
+
+    enum class FollowPolicy {
+        Never,
+        CommandLine,
+        Always
+    };
+
+    struct ShardSpec {
+        std::size_t index = 0;
+        std::size_t count = 1;
+    };
+
+    struct ProbeOptions {
+        bool security = false;
+        bool extents = false;
+        bool physical_usage = false;
+        std::shared_ptr<const Query> where;
+        std::optional<GroupKey> group_by;
+        bool sketches = false;
+        bool tree_hash = false;
+        std::optional<ShardSpec> shard;
+        std::shared_ptr<const HashSet> hashset;
+        std::optional<std::string> cache_path;
+        FollowPolicy follow = FollowPolicy::CommandLine;
+        // Zero leaves media probes unbounded.
+        std::chrono::milliseconds media_timeout {0};
+        // Zero issues directory metadata calls without a watchdog.
+        std::chrono::milliseconds stall_timeout {0};
+        // Classify every --where match for output that shows its type; an
+        // entry the query already classified keeps its type regardless.
+        bool match_types = true;
+        // Keep every --where match for output that lists them one per line
+        // (--format, --table, --sqlite, partials); text and JSON reports keep
+        // the first kMaxMatchesReported.
+        bool all_matches = false;
+    };
+
     struct CliParseResult {
         bool valid = true;
         bool show_help = false;
         bool json_output = false;
+        bool table_output = false;
+        bool fixed_widths = false;
+        bool show_timings = false;
+        bool perf_counters = false;
+        ProbeOptions probe;
+        SchedulingOptions scheduling;
         std::optional<std::string> path;
+        std::optional<std::string> partial_output;
+        std::optional<std::string> sqlite_output;
+        bool merge = false;
+        // Positional partials for --merge, text lists for --build-hashset.
+        std::vector<std::string> input_files;
+        std::optional<std::string> build_hashset;
+        std::shared_ptr<const OutputTemplate> output_template;
         std::string error_message;
     };
 
@@ -30,6 +116,59 @@ namespace file_probe {
         std::string last_change;
     };
 
+    struct SecurityInfo {
+        bool setuid = false;
+        bool setgid = false;
+        bool sticky = false;
+        std::vector<std::string> xattrs;
+        std::optional<std::string> acl;
+        std::optional<std::string> default_acl;
+        std::optional<std::string> capabilities;
+        std::vector<std::string> flags;
+    };
+
+    struct SecuritySummary {
+        size_t setuid_count = 0;
+        size_t setgid_count = 0;
+        size_t sticky_count = 0;
+        size_t capability_count = 0;
+        size_t acl_count = 0;
+        size_t immutable_count = 0;
+        size_t append_only_count = 0;
+    };
+
+    struct ExtentInfo {
+        size_t extent_count = 0;
+        size_t fragment_count = 0;
+        size_t expected_fragments = 1;
+        size_t shared_extents = 0;
+        uintmax_t shared_bytes = 0;
+        size_t unwritten_extents = 0;
+        size_t inline_extents = 0;
+        bool fragmented = false;
+    };
+
+    struct ExtentSummary {
+        size_t files_mapped = 0;
+        size_t files_unmapped = 0;
+        size_t total_extents = 0;
+        size_t fragmented_files = 0;
+        size_t files_with_shared_extents = 0;
+        uintmax_t shared_bytes = 0;
+        std::optional<std::string> most_fragmented_path;
+        size_t most_fragmented_count = 0;
+    };
+
+    struct PhysicalUsage {
+        uintmax_t referenced_bytes = 0;
+        uintmax_t physical_bytes = 0;
+        uintmax_t exclusive_bytes = 0;
+        uintmax_t shared_bytes = 0;
+        uintmax_t unmapped_bytes = 0;
+        size_t extent_count = 0;
+        size_t spill_runs = 0;
+    };
+
     struct FileDetail {
         uintmax_t size_bytes = 0;
         std::string size_human;
@@ -37,6 +176,57 @@ namespace file_probe {
         std::optional<std::string> resolution;
         std::optional<std::string> metadata;
         std::optional<std::string> duration;
+        std::optional<ExtentInfo> extents;
+        // Set when --hashset was given and the checksum could be computed.
+        std::optional<bool> hashset_match;
+    };
+
+    // Cap on the matches listed by text and JSON reports; match_count stays
+    // exact.
+    constexpr size_t kMaxMatchesReported = 10000;
+
+    struct MatchedEntry {
+        std::string path;
+        std::string type;
+        uintmax_t size_bytes = 0;
+    };
+
+    struct GroupRow {
+        std::string key;
+        size_t count = 0;
+        uintmax_t total_size_bytes = 0;
+        uintmax_t max_size_bytes = 0;
+        std::time_t newest_mtime = 0;
+    };
+
+    struct GroupSummary {
+        GroupKey key = GroupKey::Owner;
+        std::vector<GroupRow> rows;
+    };
+
+    // Cap on SymlinkSummary::dangling; the counts stay exact.
+    constexpr size_t kMaxDanglingReported = 100;
+
+    struct SymlinkSummary {
+        size_t symlink_count = 0;
+        size_t broken_count = 0;
+        size_t followed_count = 0;
+        size_t loop_count = 0;
+        std::vector<std::string> dangling;
+    };
+
+    struct HashSetSummary {
+        size_t checked_files = 0;
+        size_t matched_files = 0;
+        std::vector<std::string> matched;
+    };
+
+    struct TreeHash {
+        std::string digest;
+        // Immediate subdirectories and their digests, so a mismatch can be
+        // narrowed down by re-running on the differing child.
+        std::vector<std::pair<std::string, std::string>> children;
+        size_t unreadable_entries = 0;
     };
 
     struct DirectoryDetail {
@@ -44,6 +234,16 @@ namespace file_probe {
         std::string total_size_human;
         size_t file_count = 0;
         size_t directory_count = 0;
+        SymlinkSummary symlinks;
+        std::optional<SecuritySummary> security;
+        std::optional<ExtentSummary> extents;
+        std::optional<PhysicalUsage> physical_usage;
+        std::optional<std::vector<MatchedEntry>> matches;
+        size_t match_count = 0;
+        std::optional<GroupSummary> groups;
+        std::optional<SketchSet> sketches;
+        std::optional<HashSetSummary> hashset;
+        std::optional<TreeHash> tree_hash;
     };
 
     struct FileReport {
@@ -55,6 +255,7 @@ namespace file_probe {
         std::optional<std::string> permissions;
         std::optional<OwnershipInfo> ownership;
         std::optional<TimeInfo> timestamps;
+        std::optional<SecurityInfo> security;
         std::optional<FileDetail> file_detail;
         std::optional<DirectoryDetail> directory_detail;
         std::vector<std::string> warnings;
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -8,5 +10,7 @@ namespace file_probe {
     std::string format_permissions(std::filesystem::perms perms);
     std::string format_time(std::time_t value);
     bool is_text_file(const std::filesystem::path& path);
+    bool is_text_file(int fd);
+    bool is_text_buffer(const std::uint8_t* data, std::size_t length);
     std::string json_escape(const std::string& input);
 }
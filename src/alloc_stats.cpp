@@ -0,0 +1,108 @@
+#include <new>
+#include <array>
+#include <cstdlib>
+#include "file_probe/alloc_stats.hpp"
+
+namespace file_probe {
+
+#if defined(FILE_PROBE_INSTRUMENTED)
+    namespace {
+        // Plain thread_local storage with no constructor, so it is usable from
+        // operator new at any point in a thread's life.
+        thread_local std::array<AllocationStats, kPhaseCount + 1> thread_stats;
+
+        AllocationStats& current_bucket() {
+            const auto phase = innermost_phase();
+            return thread_stats[phase ? static_cast<std::size_t>(*phase) : kPhaseCount];
+        }
+
+        void record_allocation(std::size_t size) {
+            AllocationStats& bucket = current_bucket();
+            ++bucket.allocations;
+            bucket.bytes += size;
+        }
+
+        void record_free() {
+            ++current_bucket().frees;
+        }
+    }
+
+    bool allocation_tracking_enabled() {
+        return true;
+    }
+
+    AllocationStats thread_allocation_stats(std::optional<Phase> phase) {
+        return thread_stats[phase ? static_cast<std::size_t>(*phase) : kPhaseCount];
+    }
+#else
+    bool allocation_tracking_enabled() {
+        return false;
+    }
+
+    AllocationStats thread_allocation_stats(std::optional<Phase>) {
+        return {};
+    }
+#endif
+}
+
+#if defined(FILE_PROBE_INSTRUMENTED)
+namespace {
+    void* counted_allocate(std::size_t size) {
+        void* pointer = std::malloc(size ? size : 1);
+        if (!pointer) {
+            throw std::bad_alloc();
+        }
+        file_probe::record_allocation(size);
+        return pointer;
+    }
+
+    void* counted_allocate(std::size_t size, std::align_val_t alignment) {
+        const auto align = static_cast<std::size_t>(alignment);
+        void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+        if (!pointer) {
+            throw std::bad_alloc();
+        }
+        file_probe::record_allocation(size);
+        return pointer;
+    }
+
+    void counted_free(void* pointer) noexcept {
+        if (pointer) {
+            file_probe::record_free();
+            std::free(pointer);
+        }
+    }
+}
+
+void* operator new(std::size_t size) { return counted_allocate(size); }
+void* operator new[](std::size_t size) { return counted_allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return counted_allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return counted_allocate(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted_allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted_allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { counted_free(pointer); }
+#endif
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include "file_probe/binary_io.hpp"
+
+namespace file_probe {
+
+    void BinaryWriter::put_u8(std::uint8_t value) {
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    void BinaryWriter::put_u32(std::uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            put_u8(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+
+    void BinaryWriter::put_u64(std::uint64_t value) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            put_u8(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+
+    void BinaryWriter::put_double(double value) {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        put_u64(bits);
+    }
+
+    void BinaryWriter::put_string(const std::string& value) {
+        put_u64(value.size());
+        buffer_.append(value);
+    }
+
+    void BinaryWriter::put_optional_string(const std::optional<std::string>& value) {
+        put_u8(value ? 1 : 0);
+        if (value) {
+            put_string(*value);
+        }
+    }
+
+    void BinaryWriter::put_bytes(const void* data, std::size_t length) {
+        buffer_.append(static_cast<const char*>(data), length);
+    }
+
+    bool BinaryReader::require(std::size_t length) {
+        if (!ok_ || data_.size() - position_ < length) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    std::uint8_t BinaryReader::get_u8() {
+        if (!require(1)) {
+            return 0;
+        }
+        return static_cast<std::uint8_t>(data_[position_++]);
+    }
+
+    std::uint32_t BinaryReader::get_u32() {
+        if (!require(4)) {
+            return 0;
+        }
+        std::uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(data_[position_++])) << shift;
+        }
+        return value;
+    }
+
+    std::uint64_t BinaryReader::get_u64() {
+        if (!require(8)) {
+            return 0;
+        }
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 8) {
+            value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(data_[position_++])) << shift;
+        }
+        return value;
+    }
+
+    double BinaryReader::get_double() {
+        const std::uint64_t bits = get_u64();
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::size_t BinaryReader::get_count(std::size_t min_element_size) {
+        const std::uint64_t count = get_u64();
+        if (ok_ && count > (data_.size() - position_) / std::max<std::size_t>(min_element_size, 1)) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<std::size_t>(count);
+    }
+
+    std::string BinaryReader::get_string() {
+        const std::size_t length = get_count(1);
+        if (!require(length)) {
+            return {};
+        }
+        std::string value = data_.substr(position_, length);
+        position_ += length;
+        return value;
+    }
+
+    std::optional<std::string> BinaryReader::get_optional_string() {
+        if (get_u8() == 0) {
+            return std::nullopt;
+        }
+        return get_string();
+    }
+
+    void BinaryReader::get_bytes(void* out, std::size_t length) {
+        if (require(length)) {
+            std::memcpy(out, data_.data() + position_, length);
+            position_ += length;
+        }
+    }
+
+    std::optional<std::string> read_binary_file(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            return std::nullopt;
+        }
+        std::ostringstream contents;
+        contents << input.rdbuf();
+        return contents.str();
+    }
+
+    bool write_binary_file(const std::string& path, const std::string& data, std::string& error) {
+        return write_binary_file(path, std::vector<std::string_view> {data}, error);
+    }
+
+    bool write_binary_file(const std::string& path, const std::vector<std::string_view>& parts, std::string& error) {
+        const std::string temporary = path + ".tmp";
+        {
+            std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+            for (const auto& part : parts) {
+                output.write(part.data(), static_cast<std::streamsize>(part.size()));
+            }
+            if (!output.flush()) {
+                error = "Unable to write " + temporary;
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        std::error_code rename_error;
+        std::filesystem::rename(temporary, path, rename_error);
+        if (rename_error) {
+            error = "Unable to move " + temporary + " into place: " + rename_error.message();
+            std::remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,95 @@
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <utility>
+#include <sys/mman.h>
+#include "file_probe/buffer_pool.hpp"
+
+namespace file_probe {
+
+    namespace {
+        // 2 MiB alignment lets transparent huge pages back the whole buffer,
+        // which also satisfies the 4 KiB alignment O_DIRECT reads require.
+        constexpr std::size_t kBufferAlignment = 2 << 20;
+        constexpr std::size_t kBufferSize = 4 << 20;
+        constexpr std::size_t kMaxPooledBuffers = 8;
+
+        class BufferPool {
+        public:
+            ~BufferPool() {
+                for (std::uint8_t* buffer : free_) {
+                    std::free(buffer);
+                }
+            }
+
+            std::uint8_t* take() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!free_.empty()) {
+                        std::uint8_t* buffer = free_.back();
+                        free_.pop_back();
+                        return buffer;
+                    }
+                }
+
+                void* memory = std::aligned_alloc(kBufferAlignment, kBufferSize);
+                if (!memory) {
+                    return nullptr;
+                }
+                madvise(memory, kBufferSize, MADV_HUGEPAGE);
+                return static_cast<std::uint8_t*>(memory);
+            }
+
+            void give_back(std::uint8_t* buffer) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (free_.size() < kMaxPooledBuffers) {
+                        free_.push_back(buffer);
+                        return;
+                    }
+                }
+                std::free(buffer);
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector<std::uint8_t*> free_;
+        };
+
+        BufferPool& pool() {
+            static BufferPool instance;
+            return instance;
+        }
+    }
+
+    ReadBuffer::ReadBuffer(std::uint8_t* data, std::size_t size) : data_(data), size_(size) {}
+
+    ReadBuffer::ReadBuffer(ReadBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    ReadBuffer& ReadBuffer::operator=(ReadBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    ReadBuffer::~ReadBuffer() {
+        release();
+    }
+
+    void ReadBuffer::release() {
+        if (data_) {
+            pool().give_back(data_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    ReadBuffer acquire_read_buffer() {
+        std::uint8_t* data = pool().take();
+        return data ? ReadBuffer(data, kBufferSize) : ReadBuffer();
+    }
+}
@@ -1,6 +1,18 @@
+#include <cmath>
+#include <chrono>
 #include <vector>
+#include <cstdlib>
+#include <charconv>
 #include <iostream>
+#include <string_view>
 #include "file_probe/cli.hpp"
+#include "file_probe/query.hpp"
+#include "file_probe/shard.hpp"
+#include "file_probe/hashset.hpp"
+#include "file_probe/grouping.hpp"
+#include "file_probe/output_template.hpp"
+#include "file_probe/scheduling.hpp"
+#include "file_probe/sqlite_inventory.hpp"
 
 namespace file_probe {
 
@@ -18,7 +30,69 @@ namespace file_probe {
                 << "\n"
                 << "Options:\n"
                 << "  -h, -help, --help    Show this help message and exit\n"
-                << "  --json               Emit machine-readable JSON instead of colored text\n";
+                << "  --json               Emit machine-readable JSON instead of colored text\n"
+                << "  --table              Print aligned ls -l style rows (one per match with --where)\n"
+                << "  --fixed-widths       Use fixed --table column widths instead of a lookahead\n"
+                << "  --format=TEMPLATE    Print one line per report from TEMPLATE, e.g.\n"
+                << "                       '{path}\\t{size}\\t{sha256}'; with --where, one line per match\n"
+                << "  --format-escape=MODE Escape --format fields: raw (default), shell or csv\n"
+                << "  --extents            Report extent layout and fragmentation (FIEMAP)\n"
+                << "  --physical-usage     Count reflinked/shared extents once in directory totals\n"
+                << "  --security           Include xattrs, ACLs, capabilities and file flags\n"
+                << "  --where=EXPR         Only count and list directory entries matching EXPR,\n"
+                << "                       e.g. 'type == \"Video\" && size > 1G && mtime < now-30d'\n"
+                << "  --group-by=KEY       Aggregate directory files by owner, group, type, ext,\n"
+                << "                       mtime-month or depth\n"
+                << "  --sketches           Estimate distinct content, size/age percentiles and top\n"
+                << "                       extensions with fixed-memory sketches\n"
+                << "  --hashset=FILE       Check SHA-256 digests against a binary known-hash list\n"
+                << "  --build-hashset=OUT  Convert text hash lists given as arguments into OUT\n"
+                << "  --tree-hash          Compute a Merkle digest of a directory tree and of each\n"
+                << "                       top-level subdirectory; replaces the directory walk,\n"
+                << "                       never follows links and ignores --cache and\n"
+                << "                       --stall-timeout\n"
+                << "  --shard=I/N          Only scan shard I of N (0-based) of a directory tree\n"
+                << "  --partial-out=FILE   Write a binary partial result to FILE instead of a report\n"
+                << "  --sqlite=FILE        Append the report to an SQLite inventory (SQLITE=1 builds)\n"
+                << "  --merge              Treat arguments as partial files and report their union\n"
+                << "  --follow=POLICY      Follow symlinks: never, command-line (default) or always\n"
+                << "  --cache=FILE         Reuse directory totals from FILE for unchanged directories\n"
+                << "  --media-timeout=SEC  Give up on an audio/video probe after SEC seconds\n"
+                << "  --stall-timeout=SEC  Skip a device whose metadata calls block for SEC seconds\n"
+                << "                       (stats, directory reads, opens and content reads are\n"
+                << "                       guarded; xattr, extent and type-sniffing queries on a\n"
+                << "                       file already opened are not)\n"
+                << "  --timings            Print per-phase timings and read strategy to stderr\n"
+                << "  --perf-counters      Add per-phase CPU counters (cycles, IPC, misses) to --timings\n"
+                << "  --nice=N             Run with the given nice value (-20..19)\n"
+                << "  --ionice=CLASS       Set I/O priority: idle or be:N (N = 0..7)\n"
+                << "  --cpus=LIST          Pin probing to CPUs, e.g. 0-7 or 0,2,4-5\n"
+                << "  --numa-node=N|auto   Keep probing threads and buffers on one NUMA node\n";
+        }
+
+        bool split_value_option(const std::string& argument, std::string_view name, std::string& value) {
+            if (argument.size() <= name.size() || argument.compare(0, name.size(), name) != 0 ||
+                argument[name.size()] != '=') {
+                return false;
+            }
+            value = argument.substr(name.size() + 1);
+            return true;
+        }
+
+        bool parse_nice(const std::string& value, int& nice) {
+            const char* end = value.data() + value.size();
+            auto [ptr, ec] = std::from_chars(value.data(), end, nice);
+            return ec == std::errc() && ptr == end && !value.empty() && nice >= -20 && nice <= 19;
+        }
+
+        bool parse_timeout(const std::string& value, std::chrono::milliseconds& timeout) {
+            char* end = nullptr;
+            const double seconds = std::strtod(value.c_str(), &end);
+            if (value.empty() || end != value.c_str() + value.size() || !(seconds > 0.0) || seconds > 86400.0) {
+                return false;
+            }
+            timeout = std::chrono::milliseconds(static_cast<long long>(std::ceil(seconds * 1000.0)));
+            return true;
         }
     }
 
@@ -30,6 +104,8 @@ namespace file_probe {
         CliParseResult result;
         bool literal_mode = false;
         std::vector<std::string> positional;
+        std::optional<std::string> format;
+        TemplateEscape format_escape = TemplateEscape::Raw;
 
         for (int index = 1; index < argc; ++index) {
             std::string argument = argv[index];
@@ -46,6 +122,234 @@ namespace file_probe {
                     result.json_output = true;
                     continue;
                 }
+                if (argument == "--table") {
+                    result.table_output = true;
+                    continue;
+                }
+                if (argument == "--fixed-widths") {
+                    result.table_output = true;
+                    result.fixed_widths = true;
+                    continue;
+                }
+                if (argument == "--extents") {
+                    result.probe.extents = true;
+                    continue;
+                }
+                if (argument == "--physical-usage") {
+                    result.probe.physical_usage = true;
+                    continue;
+                }
+                if (argument == "--sketches") {
+                    result.probe.sketches = true;
+                    continue;
+                }
+                if (argument == "--tree-hash") {
+                    result.probe.tree_hash = true;
+                    continue;
+                }
+                if (argument == "--security") {
+                    result.probe.security = true;
+                    continue;
+                }
+                if (argument == "--merge") {
+                    result.merge = true;
+                    continue;
+                }
+                if (argument == "--perf-counters") {
+                    result.show_timings = true;
+                    result.perf_counters = true;
+                    continue;
+                }
+                if (argument == "--timings") {
+                    result.show_timings = true;
+                    continue;
+                }
+                std::string value;
+                if (split_value_option(argument, "--where", value) || argument == "--where") {
+                    if (argument == "--where") {
+                        if (index + 1 >= argc) {
+                            result.valid = false;
+                            result.error_message = "Missing expression for --where";
+                            return result;
+                        }
+                        value = argv[++index];
+                    }
+                    std::string query_error;
+                    result.probe.where = compile_query(value, query_error);
+                    if (!result.probe.where) {
+                        result.valid = false;
+                        result.error_message = "Invalid --where expression: " + query_error;
+                        return result;
+                    }
+                    continue;
+                }
+                if (split_value_option(argument, "--format", value) || argument == "--format") {
+                    if (argument == "--format") {
+                        if (index + 1 >= argc) {
+                            result.valid = false;
+                            result.error_message = "Missing template for --format";
+                            return result;
+                        }
+                        value = argv[++index];
+                    }
+                    format = value;
+                    continue;
+                }
+                if (split_value_option(argument, "--format-escape", value)) {
+                    auto escape = parse_template_escape(value);
+                    if (!escape) {
+                        result.valid = false;
+                        result.error_message = "Invalid format escape: " + value;
+                        return result;
+                    }
+                    format_escape = *escape;
+                    continue;
+                }
+                if (split_value_option(argument, "--group-by", value)) {
+                    auto key = parse_group_key(value);
+                    if (!key) {
+                        result.valid = false;
+                        result.error_message = "Invalid group-by key: " + value;
+                        return result;
+                    }
+                    result.probe.group_by = key;
+                    continue;
+                }
+                if (split_value_option(argument, "--hashset", value)) {
+                    std::string hashset_error;
+                    result.probe.hashset = HashSet::open(value, hashset_error);
+                    if (!result.probe.hashset) {
+                        result.valid = false;
+                        result.error_message = "Invalid --hashset: " + hashset_error;
+                        return result;
+                    }
+                    continue;
+                }
+                if (split_value_option(argument, "--build-hashset", value)) {
+                    if (value.empty()) {
+                        result.valid = false;
+                        result.error_message = "Missing output file for --build-hashset";
+                        return result;
+                    }
+                    result.build_hashset = value;
+                    continue;
+                }
+                if (split_value_option(argument, "--shard", value)) {
+                    auto shard = parse_shard(value);
+                    if (!shard) {
+                        result.valid = false;
+                        result.error_message = "Invalid shard (expected I/N with I < N): " + value;
+                        return result;
+                    }
+                    result.probe.shard = shard;
+                    continue;
+                }
+                if (split_value_option(argument, "--partial-out", value)) {
+                    if (value.empty()) {
+                        result.valid = false;
+                        result.error_message = "Missing file for --partial-out";
+                        return result;
+                    }
+                    result.partial_output = value;
+                    continue;
+                }
+                if (split_value_option(argument, "--sqlite", value)) {
+                    if (value.empty()) {
+                        result.valid = false;
+                        result.error_message = "Missing file for --sqlite";
+                        return result;
+                    }
+                    if (!sqlite_inventory_available()) {
+                        result.valid = false;
+                        result.error_message = "--sqlite is not available in this build (rebuild with make SQLITE=1)";
+                        return result;
+                    }
+                    result.sqlite_output = value;
+                    continue;
+                }
+                if (split_value_option(argument, "--follow", value)) {
+                    if (value == "never") {
+                        result.probe.follow = FollowPolicy::Never;
+                    } else if (value == "command-line") {
+                        result.probe.follow = FollowPolicy::CommandLine;
+                    } else if (value == "always") {
+                        result.probe.follow = FollowPolicy::Always;
+                    } else {
+                        result.valid = false;
+                        result.error_message = "Invalid follow policy: " + value;
+                        return result;
+                    }
+                    continue;
+                }
+                if (split_value_option(argument, "--cache", value)) {
+                    if (value.empty()) {
+                        result.valid = false;
+                        result.error_message = "Missing file for --cache";
+                        return result;
+                    }
+                    result.probe.cache_path = value;
+                    continue;
+                }
+                if (split_value_option(argument, "--media-timeout", value)) {
+                    std::chrono::milliseconds timeout {0};
+                    if (!parse_timeout(value, timeout)) {
+                        result.valid = false;
+                        result.error_message = "Invalid media timeout: " + value;
+                        return result;
+                    }
+                    result.probe.media_timeout = timeout;
+                    continue;
+                }
+                if (split_value_option(argument, "--stall-timeout", value)) {
+                    std::chrono::milliseconds timeout {0};
+                    if (!parse_timeout(value, timeout)) {
+                        result.valid = false;
+                        result.error_message = "Invalid stall timeout: " + value;
+                        return result;
+                    }
+                    result.probe.stall_timeout = timeout;
+                    continue;
+                }
+                if (split_value_option(argument, "--nice", value)) {
+                    int nice = 0;
+                    if (!parse_nice(value, nice)) {
+                        result.valid = false;
+                        result.error_message = "Invalid nice value: " + value;
+                        return result;
+                    }
+                    result.scheduling.nice = nice;
+                    continue;
+                }
+                if (split_value_option(argument, "--ionice", value)) {
+                    auto priority = parse_io_priority(value);
+                    if (!priority) {
+                        result.valid = false;
+                        result.error_message = "Invalid I/O priority: " + value;
+                        return result;
+                    }
+                    result.scheduling.io_priority = priority;
+                    continue;
+                }
+                if (split_value_option(argument, "--cpus", value)) {
+                    auto cpus = parse_cpu_list(value);
+                    if (!cpus) {
+                        result.valid = false;
+                        result.error_message = "Invalid CPU list: " + value;
+                        return result;
+                    }
+                    result.scheduling.cpus = *cpus;
+                    continue;
+                }
+                if (split_value_option(argument, "--numa-node", value)) {
+                    auto node = parse_numa_node(value);
+                    if (!node) {
+                        result.valid = false;
+                        result.error_message = "Invalid NUMA node: " + value;
+                        return result;
+                    }
+                    result.scheduling.numa_node = node;
+                    continue;
+                }
                 if (!argument.empty() && argument.front() == '-') {
                     result.valid = false;
                     result.error_message = "Unknown option: " + argument;
@@ -55,7 +359,84 @@ namespace file_probe {
             positional.push_back(argument);
         }
 
-        if (!result.show_help) {
+        if (result.build_hashset && result.merge) {
+            result.valid = false;
+            result.error_message = "--build-hashset cannot be combined with --merge";
+            return result;
+        }
+        if (result.merge && (result.probe.shard || result.partial_output)) {
+            result.valid = false;
+            result.error_message = "--merge cannot be combined with --shard or --partial-out";
+            return result;
+        }
+        if (result.sqlite_output && result.partial_output) {
+            result.valid = false;
+            result.error_message = "--sqlite cannot be combined with --partial-out";
+            return result;
+        }
+        if (result.probe.physical_usage && (result.probe.shard || result.partial_output)) {
+            result.valid = false;
+            result.error_message = "--physical-usage cannot be split across shards";
+            return result;
+        }
+        if (result.probe.tree_hash && (result.probe.shard || result.partial_output)) {
+            result.valid = false;
+            result.error_message = "--tree-hash cannot be split across shards";
+            return result;
+        }
+        if (result.probe.tree_hash && (result.probe.where || result.probe.group_by || result.probe.sketches ||
+                                       result.probe.hashset || result.probe.extents || result.probe.physical_usage ||
+                                       result.probe.security)) {
+            result.valid = false;
+            result.error_message = "--tree-hash replaces the directory walk and cannot be combined with --where, "
+                                   "--group-by, --sketches, --hashset, --extents, --physical-usage or --security";
+            return result;
+        }
+
+        if (result.table_output && (result.json_output || format || result.partial_output)) {
+            result.valid = false;
+            result.error_message = "--table cannot be combined with --json, --format or --partial-out";
+            return result;
+        }
+
+        if (format) {
+            if (result.json_output || result.partial_output) {
+                result.valid = false;
+                result.error_message = "--format cannot be combined with --json or --partial-out";
+                return result;
+            }
+            std::string template_error;
+            result.output_template = compile_template(*format, format_escape, template_error);
+            if (!result.output_template) {
+                result.valid = false;
+                result.error_message = "Invalid --format template: " + template_error;
+                return result;
+            }
+        }
+
+        // Sniffing content for a match's type is only worth it when it is shown.
+        if (result.output_template && !result.output_template->uses(TemplateField::Type)) {
+            result.probe.match_types = false;
+        }
+        result.probe.all_matches = result.output_template || result.table_output || result.sqlite_output || result.partial_output;
+
+        if (!result.show_help && result.build_hashset) {
+            if (positional.empty()) {
+                result.valid = false;
+                result.error_message = "Missing text hash lists for --build-hashset.";
+            } else {
+                result.input_files = positional;
+                result.path = positional.front();
+            }
+        } else if (!result.show_help && result.merge) {
+            if (positional.empty()) {
+                result.valid = false;
+                result.error_message = "Missing partial files to merge.";
+            } else {
+                result.input_files = positional;
+                result.path = positional.front();
+            }
+        } else if (!result.show_help) {
             if (positional.empty()) {
                 result.valid = false;
                 result.error_message = "Missing path argument.";
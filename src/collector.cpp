@@ -1,17 +1,37 @@
 #include <grp.h>
 #include <pwd.h>
+#include <map>
+#include <set>
 #include <array>
 #include <cerrno>
 #include <vector>
+#include <memory>
+#include <ctime>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
 #include <optional>
 #include <algorithm>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <string_view>
 #include <system_error>
 #include "file_probe/hash.hpp"
 #include "file_probe/media.hpp"
 #include "file_probe/utils.hpp"
+#include "file_probe/query.hpp"
+#include "file_probe/shard.hpp"
+#include "file_probe/extents.hpp"
+#include "file_probe/hashset.hpp"
+#include "file_probe/io_watchdog.hpp"
+#include "file_probe/dir_cache.hpp"
+#include "file_probe/grouping.hpp"
+#include "file_probe/timings.hpp"
+#include "file_probe/security.hpp"
+#include "file_probe/tree_hash.hpp"
+#include "file_probe/small_file.hpp"
 #include "file_probe/collector.hpp"
 
 namespace file_probe {
@@ -19,6 +39,8 @@ namespace file_probe {
     namespace {
         using Path = std::filesystem::path;
 
+        constexpr std::size_t kMaxHashSetMatchesReported = 100;
+
         constexpr std::array<std::string_view, 11> kTextExtensions = {
             ".txt", ".csv", ".log", ".json", ".xml", ".html", ".htm", ".css", ".js", ".md", ".ini"};
         constexpr std::array<std::string_view, 7> kDocumentExtensions = {
@@ -40,10 +62,7 @@ namespace file_probe {
             });
         }
 
-        std::string classify_type(const Path& path, bool is_directory) {
-            if (is_directory) {
-                return "Directory";
-            }
+        std::optional<std::string> classify_by_extension(const Path& path) {
             if (is_image_extension(path)) {
                 return "Image";
             }
@@ -62,21 +81,24 @@ namespace file_probe {
             if (matches_extension(path, kArchiveExtensions)) {
                 return "Archive";
             }
+            return std::nullopt;
+        }
 
-            if (is_text_file(path)) {
-                return "Text";
-            }
-
-            return "Binary";
+        bool is_text_contents(const SmallFile& contents) {
+            return contents.loaded ? is_text_buffer(contents.data(), contents.size) : is_text_file(contents.fd.get());
         }
 
-        std::optional<OwnershipInfo> read_ownership(const Path& path, std::vector<std::string>& warnings) {
-            struct stat info {};
-            if (stat(path.c_str(), &info) != 0) {
-                warnings.push_back("Unable to read ownership metadata: " + std::string(std::strerror(errno)));
-                return std::nullopt;
+        std::string classify_type(const Path& path, bool is_directory, const SmallFile* contents) {
+            if (is_directory) {
+                return "Directory";
+            }
+            if (auto by_name = classify_by_extension(path)) {
+                return *by_name;
             }
+            return (contents ? is_text_contents(*contents) : is_text_file(path)) ? "Text" : "Binary";
+        }
 
+        OwnershipInfo ownership_from_stat(const struct stat& info) {
             OwnershipInfo ownership;
             if (struct passwd* pwd = getpwuid(info.st_uid); pwd && pwd->pw_name) {
                 ownership.owner = pwd->pw_name;
@@ -93,13 +115,7 @@ namespace file_probe {
             return ownership;
         }
 
-        std::optional<TimeInfo> read_timestamps(const Path& path, std::vector<std::string>& warnings) {
-            struct stat info {};
-            if (stat(path.c_str(), &info) != 0) {
-                warnings.push_back("Unable to read timestamps: " + std::string(std::strerror(errno)));
-                return std::nullopt;
-            }
-
+        TimeInfo timestamps_from_stat(const struct stat& info) {
             TimeInfo timestamps;
             timestamps.last_access = format_time(info.st_atime);
             timestamps.last_modify = format_time(info.st_mtime);
@@ -107,53 +123,79 @@ namespace file_probe {
             return timestamps;
         }
 
-        FileDetail collect_file_detail(const Path& path, std::vector<std::string>& warnings) {
+        FileDetail collect_file_detail(const Path& path, const struct stat* info, const SmallFile* contents,
+                                    std::chrono::milliseconds media_timeout, std::vector<std::string>& warnings) {
             FileDetail detail;
 
-            std::error_code size_ec;
-            detail.size_bytes = std::filesystem::file_size(path, size_ec);
-            if (size_ec) {
-                warnings.push_back("Unable to read file size: " + size_ec.message());
-                detail.size_bytes = 0;
+            if (info) {
+                detail.size_bytes = static_cast<uintmax_t>(info->st_size);
+            } else {
+                std::error_code size_ec;
+                detail.size_bytes = std::filesystem::file_size(path, size_ec);
+                if (size_ec) {
+                    warnings.push_back("Unable to read file size: " + size_ec.message());
+                    detail.size_bytes = 0;
+                }
             }
-            detail.size_human = format_size(detail.size_bytes);
 
-            if (auto checksum = compute_sha256(path)) {
-                detail.checksum = *checksum;
-            } else {
-                detail.checksum = "Unavailable";
-                warnings.push_back("Unable to compute SHA-256 checksum.");
+            const bool in_memory = contents && contents->loaded;
+            {
+                ScopedPhase phase(Phase::Hash);
+                uintmax_t bytes_hashed = 0;
+                if (in_memory) {
+                    detail.checksum = sha256_hex(contents->data(), contents->size);
+                    detail.size_bytes = contents->size;
+                } else if (auto checksum = contents ? compute_sha256(contents->fd.get(), &bytes_hashed)
+                                                    : compute_sha256(path, &bytes_hashed)) {
+                    detail.checksum = *checksum;
+                    // What was hashed is the size that matches the checksum.
+                    detail.size_bytes = bytes_hashed;
+                } else {
+                    detail.checksum = "Unavailable";
+                    warnings.push_back("Unable to compute SHA-256 checksum.");
+                }
             }
+            detail.size_human = format_size(detail.size_bytes);
+
+            ScopedPhase phase(Phase::Media);
 
             const bool is_image = is_image_extension(path);
             const bool is_video = is_video_extension(path);
             const bool is_audio = is_audio_extension(path);
 
-            if (is_image || is_video) {
-                if (auto resolution = is_image ? image_resolution(path) : media_resolution(path)) {
+            if (is_image) {
+                auto resolution = in_memory ? image_resolution(contents->data(), contents->size) : image_resolution(path);
+                if (resolution) {
                     detail.resolution = resolution;
-                } else if (is_image) {
+                } else {
                     warnings.push_back("Unable to read image resolution.");
-                } else if (is_video) {
-                    warnings.push_back("Unable to read video resolution.");
                 }
-            }
-
-            if (is_image) {
-                if (auto meta = image_metadata(path)) {
+                auto meta = in_memory ? image_metadata(contents->data(), contents->size) : image_metadata(path);
+                if (meta) {
                     detail.metadata = meta;
                 } else {
                     warnings.push_back("Unable to read image metadata.");
                 }
             } else if (is_audio || is_video) {
-                if (auto meta = media_metadata(path)) {
-                    detail.metadata = meta;
-                } else {
+                MediaProbe probe = probe_media(path, media_timeout);
+                if (!probe.error.empty()) {
+                    warnings.push_back("Media probing unavailable: " + probe.error);
+                    return detail;
+                }
+                if (probe.timed_out) {
+                    warnings.push_back("Media probe timed out after " + std::to_string(media_timeout.count()) + " ms.");
+                    return detail;
+                }
+                detail.resolution = probe.resolution;
+                detail.metadata = probe.metadata;
+                detail.duration = probe.duration;
+                if (is_video && !probe.resolution) {
+                    warnings.push_back("Unable to read video resolution.");
+                }
+                if (!probe.metadata) {
                     warnings.push_back("Unable to read media metadata.");
                 }
-                if (auto duration = media_duration(path)) {
-                    detail.duration = duration;
-                } else {
+                if (!probe.duration) {
                     warnings.push_back("Unable to read media duration.");
                 }
             }
@@ -161,60 +203,541 @@ namespace file_probe {
             return detail;
         }
 
-        DirectoryDetail collect_directory_detail(const Path& path, std::vector<std::string>& warnings) {
-            DirectoryDetail detail;
+        // Only sniffs contents when the name does not decide the type.
+        std::string classify_entry(EntryContext& entry) {
+            if (auto by_name = classify_by_extension(entry.path())) {
+                return *by_name;
+            }
+            const SmallFile* contents = entry.contents();
+            return contents && is_text_contents(*contents) ? "Text" : "Binary";
+        }
 
-            std::error_code iterator_error;
-            std::filesystem::recursive_directory_iterator it(
-                path, std::filesystem::directory_options::skip_permission_denied, iterator_error);
-            std::filesystem::recursive_directory_iterator end;
+        // Reuses the file's open when there is one, so the attributes belong to
+        // the same inode as the rest of the report.
+        std::optional<SecurityInfo> read_security(const Path& path, const SmallFile* contents, mode_t mode,
+                                                  std::vector<std::string>& warnings) {
+            FileHandle opened;
+            if (!contents) {
+                opened = FileHandle(open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+                if (!opened) {
+                    warnings.push_back("Unable to read security attributes: " + std::string(std::strerror(errno)));
+                    return std::nullopt;
+                }
+            }
+            return collect_security_info(contents ? contents->fd.get() : opened.get(), mode, warnings);
+        }
 
-            if (iterator_error) {
-                warnings.push_back("Unable to traverse directory: " + iterator_error.message());
-                return detail;
+        std::optional<ExtentInfo> read_extents(const Path& path, const SmallFile* contents, uintmax_t size,
+                                               std::vector<std::string>& warnings) {
+            FileHandle opened;
+            if (!contents) {
+                opened = FileHandle(open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+                if (!opened) {
+                    warnings.push_back("Unable to map file extents: " + std::string(std::strerror(errno)));
+                    return std::nullopt;
+                }
+            }
+            std::string error;
+            auto extents = collect_extent_info(contents ? contents->fd.get() : opened.get(), size, error);
+            if (!extents) {
+                warnings.push_back("Unable to map file extents: " + error);
             }
+            return extents;
+        }
+
+        void accumulate_sketches(EntryContext& context, uintmax_t size, std::time_t now, SketchSet& sketches) {
+            // The digest is already uniformly distributed; its leading 64 bits
+            // feed HyperLogLog directly.
+            const auto& digest = context.sha256();
+            if (digest && digest->size() >= 16) {
+                sketches.distinct_content.add(std::strtoull(digest->substr(0, 16).c_str(), nullptr, 16));
+                ++sketches.hashed_files;
+            }
+
+            sketches.size_bytes.add(static_cast<double>(size));
+            if (const struct stat* info = context.info()) {
+                const double age = std::difftime(now, info->st_mtim.tv_sec) / 86400.0;
+                sketches.age_days.add(std::max(age, 0.0));
+            }
+            const std::string& extension = context.extension();
+            sketches.extensions.add(extension.empty() ? "(none)" : extension);
+        }
+
+        void accumulate_hashset(EntryContext& context, const HashSet& hashset, HashSetSummary& summary) {
+            const auto& digest = context.sha256();
+            if (!digest) {
+                return;
+            }
+            ++summary.checked_files;
+            if (hashset.contains_hex(*digest)) {
+                ++summary.matched_files;
+                if (summary.matched.size() < kMaxHashSetMatchesReported) {
+                    summary.matched.push_back(context.path().string());
+                }
+            }
+        }
+
+        // A directory on the walk's stack. Its entries are listed when it is
+        // entered; each child is stat'ed and opened relative to its fd.
+        struct WalkFrame {
+            // Shared so a call abandoned on a stalled watchdog worker can keep
+            // using it after the walk has moved on.
+            std::shared_ptr<const FileHandle> fd;
+            Path path;
+            // Absolute and normalised; only kept when stall detection has to
+            // recognise mount points.
+            std::string absolute;
+            dev_t device = 0;
+            std::size_t depth = 0;
+            std::vector<std::string> names;
+            std::size_t next = 0;
+        };
+
+        // Opens a walk entry for its security attributes only. Files and
+        // directories that cannot be read, and special files, which must not be
+        // opened for I/O, get an O_PATH descriptor; symlinks get none.
+        FileHandle open_entry_attributes(int dirfd, const char* name, mode_t mode) {
+            if (S_ISLNK(mode)) {
+                return FileHandle();
+            }
+            if (S_ISREG(mode) || S_ISDIR(mode)) {
+                const int fd = openat(dirfd, name, O_RDONLY | O_NONBLOCK | O_NOFOLLOW | O_NOCTTY | O_CLOEXEC);
+                if (fd >= 0) {
+                    return FileHandle(fd);
+                }
+            }
+            return FileHandle(openat(dirfd, name, O_PATH | O_NOFOLLOW | O_CLOEXEC));
+        }
+
+        struct DirectoryListing {
+            std::shared_ptr<const FileHandle> fd;
+            std::vector<std::string> names;
+            int error = 0;
+        };
+
+        // Opens `name` under `dirfd` as a directory and lists it. `error` is 0 or
+        // the errno of the failing call; `fd` is null when the open failed.
+        DirectoryListing list_directory(int dirfd, const char* name, bool follow_links) {
+            DirectoryListing listing;
+            FileHandle fd(openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow_links ? 0 : O_NOFOLLOW)));
+            if (!fd) {
+                listing.error = errno;
+                return listing;
+            }
+            listing.fd = std::make_shared<const FileHandle>(std::move(fd));
+            const int listing_fd = dup(listing.fd->get());
+            DIR* directory = listing_fd >= 0 ? fdopendir(listing_fd) : nullptr;
+            if (!directory) {
+                listing.error = errno;
+                if (listing_fd >= 0) {
+                    close(listing_fd);
+                }
+                return listing;
+            }
+            errno = 0;
+            while (const dirent* item = readdir(directory)) {
+                if (std::strcmp(item->d_name, ".") != 0 && std::strcmp(item->d_name, "..") != 0) {
+                    listing.names.emplace_back(item->d_name);
+                }
+            }
+            listing.error = errno;
+            closedir(directory);
+            return listing;
+        }
+
+        std::string child_path(const std::string& parent, const std::string& name) {
+            return parent == "/" ? parent + name : parent + "/" + name;
+        }
 
-            while (it != end) {
-                const auto& entry = *it;
-                std::error_code status_error;
+        DirectoryDetail collect_directory_detail(const Path& path, const ProbeOptions& options,
+                                                std::vector<std::string>& warnings) {
+            if (options.cache_path) {
+                if (!options.security && !options.extents && !options.physical_usage && !options.where &&
+                    !options.group_by && !options.sketches && !options.shard && !options.hashset &&
+                    options.follow != FollowPolicy::Always && options.stall_timeout.count() == 0) {
+                    return collect_cached_directory_detail(path, *options.cache_path, warnings);
+                }
+                warnings.push_back("--cache only covers size and count totals; ignoring it for this scan");
+            }
 
-                if (entry.is_symlink(status_error)) {
-                    it.disable_recursion_pending();
+            ScopedPhase phase(Phase::Walk);
+            DirectoryDetail detail;
+            if (options.security) {
+                detail.security.emplace();
+            }
+            if (options.extents) {
+                detail.extents.emplace();
+            }
+            if (options.where) {
+                detail.matches.emplace();
+            }
+            std::optional<GroupTable> groups;
+            if (options.group_by) {
+                groups.emplace();
+            }
+            std::optional<ExtentSet> physical_extents;
+            if (options.physical_usage) {
+                physical_extents.emplace();
+            }
+            if (options.sketches) {
+                detail.sketches.emplace();
+            }
+            if (options.hashset) {
+                detail.hashset.emplace();
+            }
+            const std::time_t now = std::time(nullptr);
+
+            // Every directory descended into when following links, so a link
+            // back to an ancestor (or a second link to the same tree) is walked
+            // only once.
+            std::set<std::pair<dev_t, ino_t>> visited;
+
+            // With a stall timeout every call that can block on a filesystem
+            // (stat, directory listing, opening and reading contents) runs on
+            // the watchdog worker of the device that answers for it: the
+            // parent's device, or the mounted one for a mount point. Symlink
+            // targets may sit anywhere and are resolved on a worker of their own.
+            std::optional<IoWatchdog> watchdog;
+            std::unordered_map<std::string, dev_t> mount_points;
+            std::map<dev_t, std::size_t> stalled_devices;
+            std::size_t unresolved_links = 0;
+            if (options.stall_timeout.count() > 0) {
+                watchdog.emplace(options.stall_timeout);
+                mount_points = mount_point_devices();
+            }
+            // Runs `call` on the worker of `device`, counting a stall against it.
+            auto guarded = [&](dev_t device, IoWatchdog::Call call) {
+                const auto outcome = watchdog->run(device, std::move(call));
+                if (outcome == IoWatchdog::Outcome::Stalled) {
+                    ++stalled_devices[device];
+                }
+                return outcome == IoWatchdog::Outcome::Ok;
+            };
+
+            std::vector<WalkFrame> stack(1);
+            stack.back().path = path;
+            DirectoryListing root = list_directory(AT_FDCWD, path.c_str(), true);
+            if (root.error != 0) {
+                if (!root.fd) {
+                    if (root.error != EACCES) {
+                        warnings.push_back("Unable to traverse directory: " + std::string(std::strerror(root.error)));
+                    }
+                    return detail;
+                }
+                warnings.push_back("Directory traversal warning: " + std::string(std::strerror(root.error)));
+            }
+            stack.back().fd = std::move(root.fd);
+            stack.back().names = std::move(root.names);
+            struct stat root_info {};
+            if (fstat(stack.back().fd->get(), &root_info) == 0) {
+                stack.back().device = root_info.st_dev;
+                if (options.follow == FollowPolicy::Always) {
+                    visited.emplace(root_info.st_dev, root_info.st_ino);
+                }
+            }
+            if (!mount_points.empty()) {
+                std::error_code absolute_error;
+                std::string absolute = std::filesystem::absolute(path, absolute_error).lexically_normal().string();
+                while (absolute.size() > 1 && absolute.back() == '/') {
+                    absolute.pop_back();
                 }
-                status_error.clear();
-
-                if (entry.is_regular_file(status_error)) {
-                    ++detail.file_count;
-                    if (!status_error) {
-                        std::error_code size_ec;
-                        uintmax_t size = entry.file_size(size_ec);
-                        if (!size_ec) {
-                            detail.total_size_bytes += size;
-                        } else {
-                            warnings.push_back("Unable to read size of " + entry.path().string() + ": " + size_ec.message());
+                if (!absolute_error) {
+                    stack.back().absolute = std::move(absolute);
+                }
+            }
+
+            while (!stack.empty()) {
+                WalkFrame& frame = stack.back();
+                if (frame.next == frame.names.size()) {
+                    stack.pop_back();
+                    continue;
+                }
+                const std::string& name = frame.names[frame.next++];
+                const int dirfd = frame.fd->get();
+                const std::size_t depth = frame.depth;
+                const Path entry_path = frame.path / name;
+                std::string entry_absolute;
+                bool descend = true;
+
+                struct stat entry_info {};
+                struct stat target_info {};
+                bool target_exists = false;
+                bool unresolved = false;
+                if (watchdog) {
+                    dev_t device = frame.device;
+                    if (!frame.absolute.empty()) {
+                        entry_absolute = child_path(frame.absolute, name);
+                        if (auto mounted = mount_points.find(entry_absolute); mounted != mount_points.end()) {
+                            device = mounted->second;
                         }
+                    }
+                    auto result = std::make_shared<struct stat>();
+                    if (!guarded(device, [result, parent = frame.fd, name] {
+                            return fstatat(parent->get(), name.c_str(), result.get(), AT_SYMLINK_NOFOLLOW) == 0;
+                        })) {
+                        continue;
+                    }
+                    entry_info = *result;
+                    if (S_ISLNK(entry_info.st_mode)) {
+                        // A target that stops answering is left unresolved; it
+                        // says nothing about the device holding the link.
+                        auto target = std::make_shared<struct stat>();
+                        const auto outcome = watchdog->run_unbound([target, parent = frame.fd, name] {
+                            return fstatat(parent->get(), name.c_str(), target.get(), 0) == 0;
+                        });
+                        target_exists = outcome == IoWatchdog::Outcome::Ok;
+                        unresolved = outcome == IoWatchdog::Outcome::Stalled;
+                        if (target_exists) {
+                            target_info = *target;
+                        }
+                    } else {
+                        target_info = entry_info;
+                        target_exists = true;
+                    }
+                } else {
+                    if (fstatat(dirfd, name.c_str(), &entry_info, AT_SYMLINK_NOFOLLOW) != 0) {
+                        continue;
+                    }
+                    if (S_ISLNK(entry_info.st_mode)) {
+                        target_exists = fstatat(dirfd, name.c_str(), &target_info, 0) == 0;
                     } else {
-                        warnings.push_back("Unable to classify " + entry.path().string() + ": " + status_error.message());
+                        target_info = entry_info;
+                        target_exists = true;
+                    }
+                }
+                const bool is_link = S_ISLNK(entry_info.st_mode);
+                const bool is_directory = target_exists && S_ISDIR(target_info.st_mode);
+
+                // Shards own entries by their first two components; a top-level
+                // directory is descended by every shard, a second-level one only
+                // by its owner.
+                bool in_shard = true;
+                if (options.shard && depth <= 1) {
+                    std::string key = name;
+                    if (depth == 1) {
+                        key = frame.path.filename().string() + "/" + key;
+                    }
+                    in_shard = shard_owns(*options.shard, key);
+                    if (!in_shard && depth == 1) {
+                        descend = false;
+                    }
+                }
+
+                bool followed = false;
+                bool revisited = false;
+                if (options.follow != FollowPolicy::Always) {
+                    if (is_link) {
+                        descend = false;
+                    }
+                } else if (in_shard && is_directory) {
+                    revisited = !visited.emplace(target_info.st_dev, target_info.st_ino).second;
+                    followed = is_link && !revisited;
+                    if (revisited) {
+                        descend = false;
+                    }
+                }
+
+                // Regular files are opened relative to their directory once, on
+                // first use, and read whole only when hashing or sniffing asks;
+                // the security and extent probes share that open.
+                // Under a watchdog the file is shared with the worker, and
+                // dropped here if a call on it stalls.
+                std::shared_ptr<SmallFile> contents;
+                bool open_done = false;
+                auto open_entry = [&]() -> SmallFile* {
+                    if (open_done || !S_ISREG(entry_info.st_mode)) {
+                        open_done = true;
+                        return contents.get();
                     }
-                } else if (entry.is_directory(status_error)) {
-                    if (!status_error) {
+                    open_done = true;
+                    if (!watchdog) {
+                        if (auto opened = open_small_file(dirfd, name.c_str())) {
+                            contents = std::make_shared<SmallFile>(std::move(*opened));
+                        }
+                        return contents.get();
+                    }
+                    auto opened = std::make_shared<std::optional<SmallFile>>();
+                    if (guarded(entry_info.st_dev, [opened, parent = frame.fd, name] {
+                            *opened = open_small_file(parent->get(), name.c_str());
+                            return opened->has_value();
+                        })) {
+                        contents = std::make_shared<SmallFile>(std::move(**opened));
+                    }
+                    return contents.get();
+                };
+                auto load_contents = [&]() -> const SmallFile* {
+                    SmallFile* file = open_entry();
+                    if (!file) {
+                        return nullptr;
+                    }
+                    if (!watchdog) {
+                        load_small_file(*file);
+                    } else if (!guarded(entry_info.st_dev, [file = contents] {
+                                   load_small_file(*file);
+                                   return true;
+                               })) {
+                        contents.reset();
+                    }
+                    return contents.get();
+                };
+                auto hash_contents = [&](const SmallFile&) -> std::optional<std::string> {
+                    auto digest = std::make_shared<std::optional<std::string>>();
+                    if (!guarded(entry_info.st_dev, [digest, file = contents] {
+                            *digest = compute_sha256(file->fd.get());
+                            return true;
+                        })) {
+                        return std::nullopt;
+                    }
+                    return *digest;
+                };
+
+                std::optional<EntryContext> context;
+                bool selected = in_shard;
+                if (in_shard && (options.where || groups || detail.sketches || detail.hashset)) {
+                    EntryContext::Hasher hasher;
+                    if (watchdog) {
+                        hasher = hash_contents;
+                    }
+                    context.emplace(entry_path, depth + 1, classify_entry, load_contents, std::move(hasher));
+                    context->set_info(entry_info);
+                }
+                if (in_shard && options.where) {
+                    selected = options.where->matches(*context);
+                }
+
+                if (selected) {
+                    uintmax_t entry_size = 0;
+
+                    if (is_link) {
+                        ++detail.symlinks.symlink_count;
+                        detail.symlinks.followed_count += followed ? 1 : 0;
+                        detail.symlinks.loop_count += revisited ? 1 : 0;
+                        if (unresolved) {
+                            ++unresolved_links;
+                        } else if (!target_exists) {
+                            ++detail.symlinks.broken_count;
+                            if (detail.symlinks.dangling.size() < kMaxDanglingReported) {
+                                std::error_code link_error;
+                                const Path target = std::filesystem::read_symlink(entry_path, link_error);
+                                detail.symlinks.dangling.push_back(entry_path.string() + " -> " +
+                                                                   (link_error ? "?" : target.string()));
+                            }
+                        }
+                    }
+
+                    if (detail.security) {
+                        FileHandle attributes;
+                        int fd = -1;
+                        if (const SmallFile* file = open_entry()) {
+                            fd = file->fd.get();
+                        } else if (!watchdog) {
+                            attributes = open_entry_attributes(dirfd, name.c_str(), entry_info.st_mode);
+                            fd = attributes.get();
+                        } else if (!watchdog->is_stalled(entry_info.st_dev)) {
+                            auto opened = std::make_shared<FileHandle>();
+                            if (guarded(entry_info.st_dev, [opened, parent = frame.fd, name, mode = entry_info.st_mode] {
+                                    *opened = open_entry_attributes(parent->get(), name.c_str(), mode);
+                                    return static_cast<bool>(*opened);
+                                })) {
+                                attributes = std::move(*opened);
+                                fd = attributes.get();
+                            }
+                        }
+                        accumulate_security(fd, entry_info.st_mode, *detail.security);
+                    }
+
+                    if (target_exists && S_ISREG(target_info.st_mode)) {
+                        ++detail.file_count;
+                        const auto size = static_cast<uintmax_t>(target_info.st_size);
+                        entry_size = size;
+                        detail.total_size_bytes += size;
+                        if (detail.extents || physical_extents) {
+                            const SmallFile* file = open_entry();
+                            const int fd = file ? file->fd.get() : -1;
+                            if (detail.extents) {
+                                accumulate_extents(fd, entry_path, size, *detail.extents);
+                            }
+                            if (physical_extents) {
+                                accumulate_physical_extents(fd, entry_info.st_dev, size, *physical_extents);
+                            }
+                        }
+                        if (groups) {
+                            groups->add(group_value(*options.group_by, *context), size, entry_info.st_mtim.tv_sec);
+                        }
+                        if (detail.sketches) {
+                            accumulate_sketches(*context, size, now, *detail.sketches);
+                        }
+                        if (detail.hashset) {
+                            accumulate_hashset(*context, *options.hashset, *detail.hashset);
+                        }
+                    } else if (is_directory) {
                         ++detail.directory_count;
                     }
+
+                    if (detail.matches && (++detail.match_count <= kMaxMatchesReported || options.all_matches)) {
+                        const bool typed = options.match_types || context->has_type();
+                        detail.matches->push_back({entry_path.string(), typed ? context->type() : std::string(), entry_size});
+                    }
                 }
 
-                it.increment(iterator_error);
-                if (iterator_error) {
-                    warnings.push_back("Directory traversal warning: " + iterator_error.message());
-                    iterator_error.clear();
+                if (descend && is_directory) {
+                    if (watchdog && watchdog->is_stalled(target_info.st_dev)) {
+                        ++stalled_devices[target_info.st_dev];
+                        continue;
+                    }
+                    DirectoryListing listing;
+                    if (!watchdog) {
+                        listing = list_directory(dirfd, name.c_str(), is_link);
+                    } else {
+                        auto result = std::make_shared<DirectoryListing>();
+                        if (!guarded(target_info.st_dev, [result, parent = frame.fd, name, is_link] {
+                                *result = list_directory(parent->get(), name.c_str(), is_link);
+                                return true;
+                            })) {
+                            continue;
+                        }
+                        listing = std::move(*result);
+                    }
+                    if (listing.error != 0 && listing.error != EACCES) {
+                        warnings.push_back("Directory traversal warning: " + entry_path.string() + ": " +
+                                           std::strerror(listing.error));
+                    }
+                    if (listing.fd) {
+                        WalkFrame child;
+                        child.fd = std::move(listing.fd);
+                        child.path = entry_path;
+                        child.absolute = std::move(entry_absolute);
+                        child.device = target_info.st_dev;
+                        child.depth = depth + 1;
+                        child.names = std::move(listing.names);
+                        stack.push_back(std::move(child));
+                    }
                 }
             }
 
+            for (const auto& [device, skipped] : stalled_devices) {
+                warnings.push_back("Device " + std::to_string(major(device)) + ":" + std::to_string(minor(device)) +
+                                   " stopped responding; skipped " + std::to_string(skipped) + " entries");
+            }
+            if (unresolved_links > 0) {
+                warnings.push_back("Left " + std::to_string(unresolved_links) +
+                                   " symlinks unresolved: their targets stopped responding");
+            }
+
+            if (physical_extents) {
+                detail.physical_usage = physical_extents->finish();
+            }
+            if (groups) {
+                detail.groups = groups->summary(*options.group_by);
+            }
+
             detail.total_size_human = format_size(detail.total_size_bytes);
             return detail;
         }
     }
 
-    FileReport collect_file_report(const Path& path) {
+    FileReport collect_file_report(const Path& path, const ProbeOptions& options) {
+        std::optional<ScopedPhase> phase(std::in_place, Phase::Metadata);
         FileReport report;
         report.input_path = path;
 
@@ -224,60 +747,95 @@ namespace file_probe {
             report.absolute_path = path;
         }
 
-        std::error_code link_status_error;
-        const auto link_status = std::filesystem::symlink_status(path, link_status_error);
-        if (!link_status_error) {
-            report.symlink.is_symlink = std::filesystem::is_symlink(link_status);
-        } else {
-            report.warnings.push_back("Unable to determine symlink status: " + link_status_error.message());
-        }
-
-        std::error_code exists_error;
-        report.target_exists = std::filesystem::exists(path, exists_error);
-        if (exists_error) {
-            report.warnings.push_back("Unable to confirm path existence: " + exists_error.message());
-            report.target_exists = false;
+        // A regular file that is not a symlink takes the fast path: one openat,
+        // one fstat and, below the size limit, one read answer everything below
+        // and feed hashing and sniffing from memory.
+        std::optional<SmallFile> contents = read_small_file(AT_FDCWD, path.c_str());
+        if (contents && !S_ISREG(contents->info.st_mode)) {
+            contents.reset();
         }
 
-        if (report.symlink.is_symlink) {
-            std::error_code target_error;
-            Path target = std::filesystem::read_symlink(path, target_error);
-            if (!target_error) {
-                report.symlink.target = target.string();
+        std::error_code status_error;
+        bool is_regular_file = false;
+        bool is_directory = false;
+        if (contents) {
+            report.target_exists = true;
+            report.permissions = format_permissions(static_cast<std::filesystem::perms>(contents->info.st_mode & 07777));
+            is_regular_file = true;
+        } else {
+            std::error_code link_status_error;
+            const auto link_status = std::filesystem::symlink_status(path, link_status_error);
+            if (!link_status_error) {
+                report.symlink.is_symlink = std::filesystem::is_symlink(link_status);
             } else {
-                report.symlink.error = target_error.message();
+                report.warnings.push_back("Unable to determine symlink status: " + link_status_error.message());
+            }
+
+            std::error_code exists_error;
+            report.target_exists = std::filesystem::exists(path, exists_error);
+            if (exists_error) {
+                report.warnings.push_back("Unable to confirm path existence: " + exists_error.message());
+                report.target_exists = false;
             }
-        }
 
-        if (!report.target_exists) {
             if (report.symlink.is_symlink) {
-                report.type = "Broken Symlink";
+                std::error_code target_error;
+                Path target = std::filesystem::read_symlink(path, target_error);
+                if (!target_error) {
+                    report.symlink.target = target.string();
+                } else {
+                    report.symlink.error = target_error.message();
+                }
+            }
+
+            if (!report.target_exists) {
+                if (report.symlink.is_symlink) {
+                    report.type = "Broken Symlink";
+                }
+                return report;
+            }
+
+            const auto status = std::filesystem::status(path, status_error);
+            if (!status_error) {
+                report.permissions = format_permissions(status.permissions());
+                is_regular_file = std::filesystem::is_regular_file(status);
+                is_directory = std::filesystem::is_directory(status);
+            } else {
+                report.warnings.push_back("Unable to read permissions: " + status_error.message());
+            }
+
+            // A regular file reached through a symlink is read through it.
+            if (is_regular_file) {
+                contents = read_small_file(AT_FDCWD, path.c_str(), kSmallFileLimit, true);
             }
-            return report;
         }
 
-        std::error_code status_error;
-        const auto status = std::filesystem::status(path, status_error);
-        if (!status_error) {
-            report.permissions = format_permissions(status.permissions());
+        struct stat info {};
+        bool has_info = false;
+        if (contents) {
+            info = contents->info;
+            has_info = true;
+        } else if (stat(path.c_str(), &info) == 0) {
+            has_info = true;
         } else {
-            report.warnings.push_back("Unable to read permissions: " + status_error.message());
+            const std::string reason = std::strerror(errno);
+            report.warnings.push_back("Unable to read ownership metadata: " + reason);
+            report.warnings.push_back("Unable to read timestamps: " + reason);
         }
 
-        if (auto ownership = read_ownership(path, report.warnings)) {
-            report.ownership = ownership;
-        }
-        if (auto timestamps = read_timestamps(path, report.warnings)) {
-            report.timestamps = timestamps;
+        if (has_info) {
+            report.ownership = ownership_from_stat(info);
+            report.timestamps = timestamps_from_stat(info);
+            if (options.security && (is_regular_file || is_directory)) {
+                report.security = read_security(path, contents ? &*contents : nullptr, info.st_mode, report.warnings);
+            }
         }
+        phase.reset();
 
-        bool is_regular_file = false;
-        bool is_directory = false;
-
+        const SmallFile* loaded = contents ? &*contents : nullptr;
         if (!status_error) {
-            is_regular_file = std::filesystem::is_regular_file(status);
-            is_directory = std::filesystem::is_directory(status);
-            report.type = classify_type(path, is_directory);
+            ScopedPhase classify_phase(Phase::Classify);
+            report.type = classify_type(path, is_directory, loaded);
         } else {
             report.warnings.push_back("Unable to determine file type: " + status_error.message());
             if (report.symlink.is_symlink) {
@@ -288,9 +846,19 @@ namespace file_probe {
         }
 
         if (is_regular_file) {
-            report.file_detail = collect_file_detail(path, report.warnings);
+            report.file_detail = collect_file_detail(path, has_info ? &info : nullptr, loaded, options.media_timeout,
+                                                     report.warnings);
+            if (options.extents) {
+                report.file_detail->extents = read_extents(path, loaded, report.file_detail->size_bytes, report.warnings);
+            }
+            if (options.hashset && report.file_detail->checksum != "Unavailable") {
+                report.file_detail->hashset_match = options.hashset->contains_hex(report.file_detail->checksum);
+            }
+        } else if (is_directory && report.symlink.is_symlink && options.follow == FollowPolicy::Never) {
+            report.warnings.push_back("Not descending into symlinked directory (--follow=never)");
         } else if (is_directory) {
-            report.directory_detail = collect_directory_detail(path, report.warnings);
+            report.directory_detail = options.tree_hash ? collect_tree_hash_detail(path, report.warnings)
+                                                        : collect_directory_detail(path, options, report.warnings);
         }
 
         return report;
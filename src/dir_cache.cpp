@@ -0,0 +1,264 @@
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <sys/stat.h>
+#include <unordered_map>
+#include "file_probe/utils.hpp"
+#include "file_probe/timings.hpp"
+#include "file_probe/dir_cache.hpp"
+#include "file_probe/binary_io.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr char kCacheMagic[8] = {'F', 'P', 'C', 'A', 'C', 'H', 'E', '\2'};
+
+        struct DirectoryKey {
+            std::uint64_t device = 0;
+            std::uint64_t inode = 0;
+            bool operator==(const DirectoryKey& other) const { return device == other.device && inode == other.inode; }
+        };
+
+        struct DirectoryKeyHash {
+            std::size_t operator()(const DirectoryKey& key) const {
+                return std::hash<std::uint64_t>()(key.inode * 0x9e3779b97f4a7c15ULL ^ key.device);
+            }
+        };
+
+        // Aggregate of the entries directly inside one directory; subtree totals
+        // are rebuilt from these on every run.
+        struct CachedDirectory {
+            std::int64_t mtime_ns = 0;
+            std::int64_t ctime_ns = 0;
+            uintmax_t size_bytes = 0;
+            std::uint64_t file_count = 0;
+            std::uint64_t directory_count = 0;
+            std::uint64_t symlink_count = 0;
+            std::uint64_t broken_count = 0;
+            std::vector<std::string> subdirectories;
+            // "name -> target" for the broken links, capped like the report.
+            std::vector<std::string> dangling;
+        };
+
+        using DirectoryCache = std::unordered_map<DirectoryKey, CachedDirectory, DirectoryKeyHash>;
+
+        std::int64_t to_nanoseconds(const struct timespec& time) {
+            return static_cast<std::int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+        }
+
+        std::optional<DirectoryCache> load_cache(const std::string& path, bool& corrupt) {
+            corrupt = false;
+            const auto data = read_binary_file(path);
+            if (!data) {
+                return std::nullopt;
+            }
+            BinaryReader reader(*data);
+            char magic[sizeof(kCacheMagic)] = {};
+            reader.get_bytes(magic, sizeof(magic));
+            if (!reader.ok() || std::memcmp(magic, kCacheMagic, sizeof(magic)) != 0) {
+                corrupt = true;
+                return std::nullopt;
+            }
+
+            DirectoryCache cache;
+            const std::size_t count = reader.get_count(80);
+            cache.reserve(count);
+            for (std::size_t i = 0; i < count && reader.ok(); ++i) {
+                DirectoryKey key;
+                key.device = reader.get_u64();
+                key.inode = reader.get_u64();
+                CachedDirectory& entry = cache[key];
+                entry.mtime_ns = static_cast<std::int64_t>(reader.get_u64());
+                entry.ctime_ns = static_cast<std::int64_t>(reader.get_u64());
+                entry.size_bytes = reader.get_u64();
+                entry.file_count = reader.get_u64();
+                entry.directory_count = reader.get_u64();
+                entry.symlink_count = reader.get_u64();
+                entry.broken_count = reader.get_u64();
+                entry.subdirectories.resize(reader.get_count(8));
+                for (auto& name : entry.subdirectories) {
+                    name = reader.get_string();
+                }
+                entry.dangling.resize(reader.get_count(8));
+                for (auto& dangling : entry.dangling) {
+                    dangling = reader.get_string();
+                }
+            }
+            if (!reader.ok() || !reader.at_end()) {
+                corrupt = true;
+                return std::nullopt;
+            }
+            return cache;
+        }
+
+        std::string encode_cache(const DirectoryCache& cache) {
+            BinaryWriter writer;
+            writer.put_bytes(kCacheMagic, sizeof(kCacheMagic));
+            writer.put_u64(cache.size());
+            for (const auto& [key, entry] : cache) {
+                writer.put_u64(key.device);
+                writer.put_u64(key.inode);
+                writer.put_u64(static_cast<std::uint64_t>(entry.mtime_ns));
+                writer.put_u64(static_cast<std::uint64_t>(entry.ctime_ns));
+                writer.put_u64(entry.size_bytes);
+                writer.put_u64(entry.file_count);
+                writer.put_u64(entry.directory_count);
+                writer.put_u64(entry.symlink_count);
+                writer.put_u64(entry.broken_count);
+                writer.put_u64(entry.subdirectories.size());
+                for (const auto& name : entry.subdirectories) {
+                    writer.put_string(name);
+                }
+                writer.put_u64(entry.dangling.size());
+                for (const auto& dangling : entry.dangling) {
+                    writer.put_string(dangling);
+                }
+            }
+            return writer.data();
+        }
+
+        class CachedWalker {
+        public:
+            CachedWalker(const DirectoryCache& previous, std::vector<std::string>& warnings)
+                : previous_(previous), warnings_(warnings) {}
+
+            // Counts mirror the uncached walk: symlinks are classified by their
+            // target but never descended into.
+            void walk(int dirfd, const struct stat& info, const std::string& display_path, DirectoryDetail& detail) {
+                const DirectoryKey key {static_cast<std::uint64_t>(info.st_dev), static_cast<std::uint64_t>(info.st_ino)};
+                if (current_.count(key) != 0) {
+                    // Bind mounts can make a directory reachable twice.
+                    return;
+                }
+                auto found = previous_.find(key);
+                CachedDirectory* entry = nullptr;
+                if (found != previous_.end() && found->second.mtime_ns == to_nanoseconds(info.st_mtim) &&
+                    found->second.ctime_ns == to_nanoseconds(info.st_ctim)) {
+                    entry = &(current_[key] = found->second);
+                } else {
+                    entry = &(current_[key] = scan(dirfd, info, display_path));
+                }
+
+                detail.total_size_bytes += entry->size_bytes;
+                detail.file_count += entry->file_count;
+                detail.directory_count += entry->directory_count;
+                detail.symlinks.symlink_count += entry->symlink_count;
+                detail.symlinks.broken_count += entry->broken_count;
+                for (const auto& dangling : entry->dangling) {
+                    if (detail.symlinks.dangling.size() >= kMaxDanglingReported) {
+                        break;
+                    }
+                    detail.symlinks.dangling.push_back(display_path + "/" + dangling);
+                }
+
+                for (const auto& name : entry->subdirectories) {
+                    const int child = openat(dirfd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    if (child < 0) {
+                        continue;
+                    }
+                    struct stat child_info {};
+                    if (fstat(child, &child_info) == 0) {
+                        walk(child, child_info, display_path + "/" + name, detail);
+                    }
+                    close(child);
+                }
+            }
+
+            DirectoryCache take() { return std::move(current_); }
+
+        private:
+            CachedDirectory scan(int dirfd, const struct stat& info, const std::string& display_path) {
+                CachedDirectory entry;
+                entry.mtime_ns = to_nanoseconds(info.st_mtim);
+                entry.ctime_ns = to_nanoseconds(info.st_ctim);
+
+                const int listing_fd = dup(dirfd);
+                DIR* listing = listing_fd >= 0 ? fdopendir(listing_fd) : nullptr;
+                if (!listing) {
+                    if (listing_fd >= 0) {
+                        close(listing_fd);
+                    }
+                    warnings_.push_back("Unable to read directory " + display_path + ": " + std::strerror(errno));
+                    return entry;
+                }
+
+                while (const dirent* item = readdir(listing)) {
+                    const char* name = item->d_name;
+                    if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) {
+                        continue;
+                    }
+                    struct stat item_info {};
+                    if (fstatat(dirfd, name, &item_info, AT_SYMLINK_NOFOLLOW) != 0) {
+                        continue;
+                    }
+                    const bool is_link = S_ISLNK(item_info.st_mode);
+                    if (is_link) {
+                        ++entry.symlink_count;
+                    }
+                    if (is_link && fstatat(dirfd, name, &item_info, 0) != 0) {
+                        ++entry.broken_count;
+                        if (entry.dangling.size() < kMaxDanglingReported) {
+                            char target[PATH_MAX];
+                            const ssize_t length = readlinkat(dirfd, name, target, sizeof(target));
+                            entry.dangling.push_back(std::string(name) + " -> " +
+                                                     (length < 0 ? std::string("?") : std::string(target, static_cast<std::size_t>(length))));
+                        }
+                        continue;
+                    }
+                    if (S_ISREG(item_info.st_mode)) {
+                        ++entry.file_count;
+                        entry.size_bytes += static_cast<uintmax_t>(item_info.st_size);
+                    } else if (S_ISDIR(item_info.st_mode)) {
+                        ++entry.directory_count;
+                        if (!is_link) {
+                            entry.subdirectories.emplace_back(name);
+                        }
+                    }
+                }
+                closedir(listing);
+                return entry;
+            }
+
+            const DirectoryCache& previous_;
+            DirectoryCache current_;
+            std::vector<std::string>& warnings_;
+        };
+    }
+
+    DirectoryDetail collect_cached_directory_detail(const std::filesystem::path& path, const std::string& cache_path,
+                                                    std::vector<std::string>& warnings) {
+        ScopedPhase phase(Phase::Walk);
+        DirectoryDetail detail;
+
+        bool corrupt = false;
+        DirectoryCache previous = load_cache(cache_path, corrupt).value_or(DirectoryCache {});
+        if (corrupt) {
+            warnings.push_back("Ignoring unreadable directory cache " + cache_path);
+        }
+
+        const int root = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        struct stat root_info {};
+        if (root < 0 || fstat(root, &root_info) != 0) {
+            warnings.push_back("Unable to traverse directory: " + std::string(std::strerror(errno)));
+            if (root >= 0) {
+                close(root);
+            }
+            return detail;
+        }
+
+        CachedWalker walker(previous, warnings);
+        walker.walk(root, root_info, path.string(), detail);
+        close(root);
+
+        std::string cache_error;
+        if (!write_binary_file(cache_path, encode_cache(walker.take()), cache_error)) {
+            warnings.push_back("Unable to update directory cache: " + cache_error);
+        }
+
+        detail.total_size_human = format_size(detail.total_size_bytes);
+        return detail;
+    }
+}
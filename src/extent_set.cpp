@@ -0,0 +1,223 @@
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include "file_probe/extent_set.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr std::size_t kRunReadBatch = 4096;
+
+        using Record = ExtentSet::Record;
+
+        bool record_less(const Record& left, const Record& right) {
+            if (left.device != right.device) {
+                return left.device < right.device;
+            }
+            if (left.start != right.start) {
+                return left.start < right.start;
+            }
+            return left.end < right.end;
+        }
+
+        // Sequential reader over one sorted source: either a spilled run or the
+        // in-memory remainder.
+        class RunCursor {
+        public:
+            explicit RunCursor(std::FILE* file) : file_(file) {
+                std::rewind(file_);
+                refill();
+            }
+
+            explicit RunCursor(std::vector<Record> records) : batch_(std::move(records)) {}
+
+            bool done() const { return position_ >= batch_.size(); }
+            const Record& current() const { return batch_[position_]; }
+
+            void advance() {
+                ++position_;
+                if (position_ >= batch_.size() && file_) {
+                    refill();
+                }
+            }
+
+        private:
+            void refill() {
+                batch_.resize(kRunReadBatch);
+                const std::size_t count = std::fread(batch_.data(), sizeof(Record), batch_.size(), file_);
+                batch_.resize(count);
+                position_ = 0;
+                if (count == 0) {
+                    file_ = nullptr;
+                }
+            }
+
+            std::FILE* file_ = nullptr;
+            std::vector<Record> batch_;
+            std::size_t position_ = 0;
+        };
+
+        // Sweep line over records sorted by (device, start). Active extents sit in
+        // a min-heap by end offset; every segment between two event points is
+        // attributed once, weighted by how many extents cover it.
+        class CoverageSweep {
+        public:
+            explicit CoverageSweep(PhysicalUsage& usage) : usage_(usage) {}
+
+            void push(const Record& record) {
+                if (!has_device_ || record.device != device_) {
+                    drain(std::numeric_limits<std::uint64_t>::max());
+                    device_ = record.device;
+                    has_device_ = true;
+                    position_ = record.start;
+                }
+                drain(record.start);
+                if (active_count_ == 0) {
+                    position_ = record.start;
+                }
+                active_.push({record.end, record.count});
+                active_count_ += record.count;
+            }
+
+            void finish() {
+                drain(std::numeric_limits<std::uint64_t>::max());
+            }
+
+        private:
+            struct ActiveExtent {
+                std::uint64_t end;
+                std::uint64_t count;
+                bool operator>(const ActiveExtent& other) const { return end > other.end; }
+            };
+
+            void drain(std::uint64_t limit) {
+                while (!active_.empty() && active_.top().end <= limit) {
+                    const ActiveExtent top = active_.top();
+                    active_.pop();
+                    account(top.end);
+                    active_count_ -= top.count;
+                }
+                if (active_count_ > 0 && limit != std::numeric_limits<std::uint64_t>::max()) {
+                    account(limit);
+                }
+            }
+
+            void account(std::uint64_t until) {
+                if (until <= position_) {
+                    return;
+                }
+                const std::uint64_t length = until - position_;
+                if (active_count_ == 1) {
+                    usage_.exclusive_bytes += length;
+                } else if (active_count_ > 1) {
+                    usage_.shared_bytes += length;
+                }
+                position_ = until;
+            }
+
+            PhysicalUsage& usage_;
+            std::priority_queue<ActiveExtent, std::vector<ActiveExtent>, std::greater<ActiveExtent>> active_;
+            std::uint64_t active_count_ = 0;
+            std::uint64_t position_ = 0;
+            std::uint64_t device_ = 0;
+            bool has_device_ = false;
+        };
+    }
+
+    ExtentSet::ExtentSet(std::size_t max_buffered) : max_buffered_(std::max<std::size_t>(max_buffered, 1024)) {
+        buffer_.reserve(std::min<std::size_t>(max_buffered_, 1 << 16));
+    }
+
+    void ExtentSet::add(std::uint64_t device, std::uint64_t physical, std::uint64_t length) {
+        if (length == 0) {
+            return;
+        }
+        ++usage_.extent_count;
+        usage_.referenced_bytes += length;
+        buffer_.push_back({device, physical, physical + length, 1});
+
+        if (buffer_.size() >= max_buffered_) {
+            compact();
+            // Reflinked copies collapse into counted records; only spill when
+            // compaction did not free at least half of the batch.
+            if (buffer_.size() >= max_buffered_ / 2) {
+                spill();
+            }
+        }
+    }
+
+    void ExtentSet::add_unmapped(std::uint64_t length) {
+        usage_.referenced_bytes += length;
+        usage_.unmapped_bytes += length;
+    }
+
+    void ExtentSet::compact() {
+        std::sort(buffer_.begin(), buffer_.end(), record_less);
+        std::size_t out = 0;
+        for (std::size_t in = 0; in < buffer_.size(); ++in) {
+            if (out > 0 && buffer_[out - 1].device == buffer_[in].device &&
+                buffer_[out - 1].start == buffer_[in].start && buffer_[out - 1].end == buffer_[in].end) {
+                buffer_[out - 1].count += buffer_[in].count;
+            } else {
+                buffer_[out++] = buffer_[in];
+            }
+        }
+        buffer_.resize(out);
+    }
+
+    void ExtentSet::spill() {
+        std::unique_ptr<std::FILE, FileCloser> run(std::tmpfile());
+        if (!run) {
+            // Without a spill file keep growing in memory rather than losing data.
+            max_buffered_ *= 2;
+            return;
+        }
+        if (std::fwrite(buffer_.data(), sizeof(Record), buffer_.size(), run.get()) != buffer_.size()) {
+            max_buffered_ *= 2;
+            return;
+        }
+        runs_.push_back(std::move(run));
+        buffer_.clear();
+    }
+
+    PhysicalUsage ExtentSet::finish() {
+        compact();
+
+        std::vector<RunCursor> cursors;
+        cursors.reserve(runs_.size() + 1);
+        for (auto& run : runs_) {
+            cursors.emplace_back(run.get());
+        }
+        cursors.emplace_back(std::move(buffer_));
+        buffer_.clear();
+
+        auto cursor_greater = [&](std::size_t left, std::size_t right) {
+            return record_less(cursors[right].current(), cursors[left].current());
+        };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(cursor_greater)> heads(cursor_greater);
+        for (std::size_t index = 0; index < cursors.size(); ++index) {
+            if (!cursors[index].done()) {
+                heads.push(index);
+            }
+        }
+
+        PhysicalUsage usage = usage_;
+        usage.spill_runs = runs_.size();
+        CoverageSweep sweep(usage);
+        while (!heads.empty()) {
+            const std::size_t index = heads.top();
+            heads.pop();
+            sweep.push(cursors[index].current());
+            cursors[index].advance();
+            if (!cursors[index].done()) {
+                heads.push(index);
+            }
+        }
+        sweep.finish();
+        runs_.clear();
+
+        usage.physical_bytes = usage.exclusive_bytes + usage.shared_bytes + usage.unmapped_bytes;
+        usage.exclusive_bytes += usage.unmapped_bytes;
+        return usage;
+    }
+}
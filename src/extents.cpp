@@ -0,0 +1,152 @@
+#include <cerrno>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <linux/fiemap.h>
+#include "file_probe/extents.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr std::size_t kExtentBatch = 256;
+        // Largest extent ext4 and XFS hand out in practice; files bigger than
+        // this legitimately need more than one extent.
+        constexpr uintmax_t kMaxExtentBytes = 128ULL * 1024 * 1024;
+
+        // Walks the FIEMAP table in batches without touching file data.
+        // Returns 0 on success or the errno of the failing ioctl.
+        template <typename Visitor>
+        int visit_extents(int fd, Visitor&& visit) {
+            std::vector<std::uint8_t> storage(sizeof(struct fiemap) + kExtentBatch * sizeof(struct fiemap_extent));
+            auto* map = reinterpret_cast<struct fiemap*>(storage.data());
+            __u64 start = 0;
+
+            while (true) {
+                std::memset(storage.data(), 0, storage.size());
+                map->fm_start = start;
+                map->fm_length = FIEMAP_MAX_OFFSET - start;
+                map->fm_extent_count = kExtentBatch;
+
+                if (ioctl(fd, FS_IOC_FIEMAP, map) != 0) {
+                    return errno;
+                }
+                if (map->fm_mapped_extents == 0) {
+                    return 0;
+                }
+
+                const struct fiemap_extent* extent = nullptr;
+                for (__u32 index = 0; index < map->fm_mapped_extents; ++index) {
+                    extent = &map->fm_extents[index];
+                    visit(*extent);
+                }
+
+                if (extent->fe_flags & FIEMAP_EXTENT_LAST) {
+                    return 0;
+                }
+                start = extent->fe_logical + extent->fe_length;
+            }
+        }
+    }
+
+    std::optional<ExtentInfo> collect_extent_info(int fd, uintmax_t size, std::string& error) {
+        ExtentInfo info;
+        info.expected_fragments = static_cast<size_t>(std::max<uintmax_t>(1, (size + kMaxExtentBytes - 1) / kMaxExtentBytes));
+
+        bool has_previous = false;
+        __u64 previous_physical_end = 0;
+        __u64 previous_logical_end = 0;
+
+        const int result = visit_extents(fd, [&](const struct fiemap_extent& extent) {
+            ++info.extent_count;
+            if (extent.fe_flags & FIEMAP_EXTENT_SHARED) {
+                ++info.shared_extents;
+                info.shared_bytes += extent.fe_length;
+            }
+            if (extent.fe_flags & FIEMAP_EXTENT_UNWRITTEN) {
+                ++info.unwritten_extents;
+            }
+            if (extent.fe_flags & (FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL)) {
+                ++info.inline_extents;
+            }
+
+            // Extents the filesystem split only at its size limit are still
+            // physically contiguous and do not count as separate fragments.
+            const bool contiguous = has_previous &&
+                extent.fe_physical == previous_physical_end &&
+                extent.fe_logical == previous_logical_end;
+            if (!contiguous) {
+                ++info.fragment_count;
+            }
+            has_previous = true;
+            previous_physical_end = extent.fe_physical + extent.fe_length;
+            previous_logical_end = extent.fe_logical + extent.fe_length;
+        });
+
+        if (result != 0) {
+            error = std::strerror(result);
+            return std::nullopt;
+        }
+
+        info.fragmented = info.fragment_count > info.expected_fragments;
+        return info;
+    }
+
+    void accumulate_extents(int fd, const std::filesystem::path& path, uintmax_t size, ExtentSummary& summary) {
+        if (fd < 0) {
+            ++summary.files_unmapped;
+            return;
+        }
+
+        std::string error;
+        auto info = collect_extent_info(fd, size, error);
+        if (!info) {
+            ++summary.files_unmapped;
+            return;
+        }
+
+        ++summary.files_mapped;
+        summary.total_extents += info->extent_count;
+        summary.shared_bytes += info->shared_bytes;
+        if (info->fragmented) {
+            ++summary.fragmented_files;
+        }
+        if (info->shared_extents > 0) {
+            ++summary.files_with_shared_extents;
+        }
+        if (info->fragment_count > 1 && info->fragment_count > summary.most_fragmented_count) {
+            summary.most_fragmented_count = info->fragment_count;
+            summary.most_fragmented_path = path.string();
+        }
+    }
+
+    void accumulate_physical_extents(int fd, std::uint64_t device, uintmax_t size, ExtentSet& set) {
+        if (fd < 0) {
+            set.add_unmapped(size);
+            return;
+        }
+
+        // Extents without a stable physical address (delayed allocation, inline
+        // data) cannot be shared and are counted as unmapped instead.
+        // A map that fails partway is discarded whole, so nothing is committed
+        // to the set until every batch has been read.
+        constexpr __u32 kNoPhysicalAddress = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_DATA_INLINE;
+        std::vector<struct fiemap_extent> extents;
+        const int result = visit_extents(fd, [&](const struct fiemap_extent& extent) { extents.push_back(extent); });
+
+        if (result != 0) {
+            set.add_unmapped(size);
+            return;
+        }
+        for (const auto& extent : extents) {
+            if (extent.fe_flags & kNoPhysicalAddress) {
+                set.add_unmapped(extent.fe_length);
+            } else {
+                set.add(device, extent.fe_physical, extent.fe_length);
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include "file_probe/ffmpeg_api.hpp"
+
+#if defined(FILE_PROBE_FFMPEG_DLOPEN)
+#include <dlfcn.h>
+#endif
+
+namespace file_probe {
+
+#if defined(FILE_PROBE_FFMPEG_DLOPEN)
+    namespace {
+        struct LoadedApi {
+            FfmpegApi api {};
+            std::string error;
+        };
+
+        // Only the major version the headers were built against is ABI
+        // compatible, so the unversioned development symlink is never used.
+        void* open_library(const std::string& name, int major, std::string& error) {
+            const std::string soname = name + ".so." + std::to_string(major);
+            void* handle = dlopen(soname.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (!handle && error.empty()) {
+                const char* reason = dlerror();
+                error = reason ? reason : "Unable to load " + soname;
+            }
+            return handle;
+        }
+
+        template <typename Function>
+        void resolve(void* library, const char* symbol, Function& target, std::string& error) {
+            if (!library) {
+                return;
+            }
+            target = reinterpret_cast<Function>(dlsym(library, symbol));
+            if (!target && error.empty()) {
+                error = std::string("Missing FFmpeg symbol ") + symbol;
+            }
+        }
+
+        LoadedApi load_api() {
+            LoadedApi loaded;
+            void* format = open_library("libavformat", LIBAVFORMAT_VERSION_MAJOR, loaded.error);
+            void* codec = open_library("libavcodec", LIBAVCODEC_VERSION_MAJOR, loaded.error);
+            resolve(format, "avformat_alloc_context", loaded.api.alloc_context, loaded.error);
+            resolve(format, "avformat_free_context", loaded.api.free_context, loaded.error);
+            resolve(format, "avformat_open_input", loaded.api.open_input, loaded.error);
+            resolve(format, "avformat_find_stream_info", loaded.api.find_stream_info, loaded.error);
+            resolve(format, "avformat_close_input", loaded.api.close_input, loaded.error);
+            resolve(codec, "avcodec_get_name", loaded.api.codec_name, loaded.error);
+            return loaded;
+        }
+    }
+
+    const FfmpegApi* ffmpeg_api(std::string& error) {
+        static const LoadedApi loaded = load_api();
+        if (!loaded.error.empty()) {
+            error = loaded.error;
+            return nullptr;
+        }
+        return &loaded.api;
+    }
+#else
+    const FfmpegApi* ffmpeg_api(std::string&) {
+        static const FfmpegApi api {
+            &::avformat_alloc_context,
+            &::avformat_free_context,
+            &::avformat_open_input,
+            &::avformat_find_stream_info,
+            &::avformat_close_input,
+            &::avcodec_get_name,
+        };
+        return &api;
+    }
+#endif
+}
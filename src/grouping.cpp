@@ -0,0 +1,92 @@
+#include <ctime>
+#include <array>
+#include <algorithm>
+#include <string_view>
+#include "file_probe/grouping.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr std::array<std::string_view, 6> kGroupKeyNames = {
+            "owner", "group", "type", "ext", "mtime-month", "depth"};
+
+        std::string month_of(std::time_t value) {
+            std::tm tm_snapshot {};
+            if (!localtime_r(&value, &tm_snapshot)) {
+                return "unknown";
+            }
+            char buffer[8] = {};
+            std::strftime(buffer, sizeof(buffer), "%Y-%m", &tm_snapshot);
+            return buffer;
+        }
+    }
+
+    std::optional<GroupKey> parse_group_key(const std::string& value) {
+        for (std::size_t index = 0; index < kGroupKeyNames.size(); ++index) {
+            if (kGroupKeyNames[index] == value) {
+                return static_cast<GroupKey>(index);
+            }
+        }
+        return std::nullopt;
+    }
+
+    const char* group_key_name(GroupKey key) {
+        return kGroupKeyNames[static_cast<std::size_t>(key)].data();
+    }
+
+    std::string group_value(GroupKey key, EntryContext& entry) {
+        switch (key) {
+            case GroupKey::Owner: return entry.owner();
+            case GroupKey::Group: return entry.group();
+            case GroupKey::Type: return entry.type();
+            case GroupKey::Extension: return entry.extension().empty() ? "(none)" : entry.extension();
+            case GroupKey::MtimeMonth: {
+                const struct stat* info = entry.info();
+                return info ? month_of(info->st_mtim.tv_sec) : "unknown";
+            }
+            case GroupKey::Depth: return std::to_string(entry.depth());
+        }
+        return "unknown";
+    }
+
+    void GroupTable::add(const std::string& key, uintmax_t size, std::time_t mtime) {
+        GroupRow& row = rows_[key];
+        ++row.count;
+        row.total_size_bytes += size;
+        row.max_size_bytes = std::max(row.max_size_bytes, size);
+        row.newest_mtime = std::max(row.newest_mtime, mtime);
+    }
+
+    void GroupTable::add(const GroupRow& row) {
+        GroupRow& target = rows_[row.key];
+        target.count += row.count;
+        target.total_size_bytes += row.total_size_bytes;
+        target.max_size_bytes = std::max(target.max_size_bytes, row.max_size_bytes);
+        target.newest_mtime = std::max(target.newest_mtime, row.newest_mtime);
+    }
+
+    void GroupTable::merge(const GroupTable& other) {
+        for (const auto& [key, row] : other.rows_) {
+            GroupRow keyed = row;
+            keyed.key = key;
+            add(keyed);
+        }
+    }
+
+    GroupSummary GroupTable::summary(GroupKey key) const {
+        GroupSummary summary;
+        summary.key = key;
+        summary.rows.reserve(rows_.size());
+        for (const auto& [name, row] : rows_) {
+            summary.rows.push_back(row);
+            summary.rows.back().key = name;
+        }
+        std::sort(summary.rows.begin(), summary.rows.end(), [](const GroupRow& left, const GroupRow& right) {
+            if (left.total_size_bytes != right.total_size_bytes) {
+                return left.total_size_bytes > right.total_size_bytes;
+            }
+            return left.key < right.key;
+        });
+        return summary;
+    }
+}
@@ -1,173 +1,263 @@
+#include <map>
 #include <array>
+#include <mutex>
+#include <chrono>
+#include <cerrno>
+#include <fcntl.h>
 #include <cstdint>
 #include <cstring>
-#include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <utility>
+#include <unistd.h>
 #include <algorithm>
+#include <sys/stat.h>
+#include <sys/vfs.h>
 #include "file_probe/hash.hpp"
+#include "file_probe/timings.hpp"
+#include "file_probe/buffer_pool.hpp"
 
 namespace file_probe {
 
     namespace {
-        class Sha256 {
-        public:
-            Sha256() {
-                reset();
+        std::uint32_t rotr(std::uint32_t value, std::uint32_t count) {
+            return (value >> count) | (value << (32 - count));
+        }
+
+        constexpr std::size_t kKiB = 1024;
+        constexpr std::size_t kMiB = 1024 * kKiB;
+        constexpr std::size_t kMinChunk = 64 * kKiB;
+        constexpr std::size_t kReadaheadChunks = 4;
+        constexpr uintmax_t kTuningWindowBytes = 16 * kMiB;
+
+        struct ReadDefaults {
+            const char* name;
+            std::size_t chunk;
+            std::size_t readahead;
+        };
+
+        constexpr ReadDefaults kGenericDefaults = {"generic", 256 * kKiB, 2 * kMiB};
+
+        // Starting points per statfs f_type; network filesystems want reads that
+        // match their transfer size (NFS rsize, Ceph object size), FUSE daemons
+        // usually cap requests at 128 KiB.
+        ReadDefaults defaults_for_filesystem(long f_type) {
+            switch (static_cast<unsigned long>(f_type)) {
+                case 0xEF53UL: return {"ext4", 256 * kKiB, 2 * kMiB};
+                case 0x58465342UL: return {"xfs", 256 * kKiB, 2 * kMiB};
+                case 0x9123683EUL: return {"btrfs", 256 * kKiB, 2 * kMiB};
+                case 0x2FC12FC1UL: return {"zfs", 1 * kMiB, 4 * kMiB};
+                case 0x01021994UL: return {"tmpfs", 1 * kMiB, 0};
+                case 0x794C7630UL: return {"overlayfs", 256 * kKiB, 2 * kMiB};
+                case 0x6969UL: return {"nfs", 1 * kMiB, 8 * kMiB};
+                case 0xFF534D42UL: return {"cifs", 1 * kMiB, 4 * kMiB};
+                case 0xFE534D42UL: return {"smb2", 1 * kMiB, 4 * kMiB};
+                case 0x00C36400UL: return {"cephfs", 4 * kMiB, 16 * kMiB};
+                case 0x65735546UL: return {"fuse", 128 * kKiB, 1 * kMiB};
+                default: return kGenericDefaults;
             }
+        }
 
-            void update(const std::uint8_t* data, std::size_t length) {
-                while (length > 0) {
-                    std::size_t space = block_size - buffer_size_;
-                    std::size_t to_copy = std::min(space, length);
-                    std::memcpy(buffer_.data() + buffer_size_, data, to_copy);
-                    buffer_size_ += to_copy;
-                    data += to_copy;
-                    length -= to_copy;
-                    bit_count_ += static_cast<std::uint64_t>(to_copy) * 8;
-
-                    if (buffer_size_ == block_size) {
-                        process_block(buffer_.data());
-                        buffer_size_ = 0;
-                    }
-                }
+        std::size_t clamp_chunk(std::size_t chunk, std::size_t block_size, std::size_t capacity) {
+            chunk = std::max(chunk, std::max(block_size, kMinChunk));
+            if (block_size > 0) {
+                chunk -= chunk % block_size;
             }
+            return std::min(std::max(chunk, block_size), capacity);
+        }
 
-            std::array<std::uint8_t, 32> finalize() {
-                buffer_[buffer_size_++] = 0x80;
-                if (buffer_size_ > 56) {
-                    while (buffer_size_ < block_size) {
-                        buffer_[buffer_size_++] = 0;
-                    }
-                    process_block(buffer_.data());
-                    buffer_size_ = 0;
-                }
+        std::mutex learned_mutex;
+        std::map<dev_t, std::size_t> learned_chunks;
 
-                while (buffer_size_ < 56) {
-                    buffer_[buffer_size_++] = 0;
-                }
+        std::optional<std::size_t> learned_chunk(dev_t device) {
+            std::lock_guard<std::mutex> lock(learned_mutex);
+            auto it = learned_chunks.find(device);
+            if (it == learned_chunks.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        void remember_chunk(dev_t device, std::size_t chunk) {
+            std::lock_guard<std::mutex> lock(learned_mutex);
+            learned_chunks[device] = chunk;
+        }
+
+        // Hill climbing over fixed-size windows: keep doubling the chunk while
+        // throughput improves, step back once when it regresses, then settle.
+        class ThroughputTuner {
+        public:
+            ThroughputTuner(std::size_t chunk, std::size_t capacity)
+                : chunk_(chunk), capacity_(capacity), window_start_(std::chrono::steady_clock::now()) {}
 
-                for (int shift = 56; shift >= 0; shift -= 8) {
-                    buffer_[buffer_size_++] = static_cast<std::uint8_t>((bit_count_ >> shift) & 0xFF);
+            std::optional<std::size_t> record(std::size_t bytes) {
+                if (settled_) {
+                    return std::nullopt;
+                }
+                window_bytes_ += bytes;
+                if (window_bytes_ < kTuningWindowBytes) {
+                    return std::nullopt;
                 }
 
-                process_block(buffer_.data());
+                const auto now = std::chrono::steady_clock::now();
+                const double seconds = std::chrono::duration<double>(now - window_start_).count();
+                const double throughput = seconds > 0.0 ? static_cast<double>(window_bytes_) / seconds : 0.0;
+                window_start_ = now;
+                window_bytes_ = 0;
+
+                if (best_throughput_ > 0.0 && throughput < best_throughput_ * 1.05) {
+                    settled_ = true;
+                    if (throughput < best_throughput_ * 0.9 && chunk_ != best_chunk_) {
+                        chunk_ = best_chunk_;
+                        return chunk_;
+                    }
+                    return std::nullopt;
+                }
 
-                std::array<std::uint8_t, 32> digest {};
-                for (std::size_t i = 0; i < 8; ++i) {
-                    digest[i * 4 + 0] = static_cast<std::uint8_t>((state_[i] >> 24) & 0xFF);
-                    digest[i * 4 + 1] = static_cast<std::uint8_t>((state_[i] >> 16) & 0xFF);
-                    digest[i * 4 + 2] = static_cast<std::uint8_t>((state_[i] >> 8) & 0xFF);
-                    digest[i * 4 + 3] = static_cast<std::uint8_t>(state_[i] & 0xFF);
+                best_throughput_ = throughput;
+                best_chunk_ = chunk_;
+                if (chunk_ * 2 > capacity_) {
+                    settled_ = true;
+                    return std::nullopt;
                 }
-                return digest;
+                chunk_ *= 2;
+                return chunk_;
             }
 
+            bool settled() const { return settled_; }
+
         private:
-            static constexpr std::size_t block_size = 64;
+            std::size_t chunk_;
+            std::size_t capacity_;
+            std::size_t best_chunk_ = 0;
+            double best_throughput_ = 0.0;
+            uintmax_t window_bytes_ = 0;
+            bool settled_ = false;
+            std::chrono::steady_clock::time_point window_start_;
+        };
+    }
+
+    Sha256::Sha256() {
+        reset();
+    }
+
+    void Sha256::reset() {
+        state_ = {
+            0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU,
+            0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U};
+        bit_count_ = 0;
+        buffer_size_ = 0;
+    }
+
+    void Sha256::update(const std::uint8_t* data, std::size_t length) {
+        while (length > 0) {
+            std::size_t space = kBlockSize - buffer_size_;
+            std::size_t to_copy = std::min(space, length);
+            std::memcpy(buffer_.data() + buffer_size_, data, to_copy);
+            buffer_size_ += to_copy;
+            data += to_copy;
+            length -= to_copy;
+            bit_count_ += static_cast<std::uint64_t>(to_copy) * 8;
 
-            void reset() {
-                state_ = {
-                    0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU,
-                    0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U};
-                bit_count_ = 0;
+            if (buffer_size_ == kBlockSize) {
+                process_block(buffer_.data());
                 buffer_size_ = 0;
             }
+        }
+    }
 
-            static std::uint32_t rotr(std::uint32_t value, std::uint32_t count) {
-                return (value >> count) | (value << (32 - count));
+    Sha256Digest Sha256::finalize() {
+        buffer_[buffer_size_++] = 0x80;
+        if (buffer_size_ > 56) {
+            while (buffer_size_ < kBlockSize) {
+                buffer_[buffer_size_++] = 0;
             }
+            process_block(buffer_.data());
+            buffer_size_ = 0;
+        }
 
-            void process_block(const std::uint8_t* block) {
-                static const std::uint32_t k[64] = {
-                    0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
-                    0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
-                    0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
-                    0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
-                    0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
-                    0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
-                    0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
-                    0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U};
-
-                std::uint32_t w[64];
-                for (std::size_t i = 0; i < 16; ++i) {
-                    w[i] = (static_cast<std::uint32_t>(block[i * 4 + 0]) << 24) |
-                        (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16) |
-                        (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8) |
-                        (static_cast<std::uint32_t>(block[i * 4 + 3]));
-                }
-                for (std::size_t i = 16; i < 64; ++i) {
-                    std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
-                    std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
-                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
-                }
+        while (buffer_size_ < 56) {
+            buffer_[buffer_size_++] = 0;
+        }
 
-                std::uint32_t a = state_[0];
-                std::uint32_t b = state_[1];
-                std::uint32_t c = state_[2];
-                std::uint32_t d = state_[3];
-                std::uint32_t e = state_[4];
-                std::uint32_t f = state_[5];
-                std::uint32_t g = state_[6];
-                std::uint32_t h = state_[7];
-
-                for (std::size_t i = 0; i < 64; ++i) {
-                    std::uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
-                    std::uint32_t ch = (e & f) ^ ((~e) & g);
-                    std::uint32_t temp1 = h + s1 + ch + k[i] + w[i];
-                    std::uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
-                    std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
-                    std::uint32_t temp2 = s0 + maj;
-
-                    h = g;
-                    g = f;
-                    f = e;
-                    e = d + temp1;
-                    d = c;
-                    c = b;
-                    b = a;
-                    a = temp1 + temp2;
-                }
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            buffer_[buffer_size_++] = static_cast<std::uint8_t>((bit_count_ >> shift) & 0xFF);
+        }
 
-                state_[0] += a;
-                state_[1] += b;
-                state_[2] += c;
-                state_[3] += d;
-                state_[4] += e;
-                state_[5] += f;
-                state_[6] += g;
-                state_[7] += h;
-            }
+        process_block(buffer_.data());
 
-            std::array<std::uint32_t, 8> state_ {};
-            std::array<std::uint8_t, block_size> buffer_ {};
-            std::uint64_t bit_count_ = 0;
-            std::size_t buffer_size_ = 0;
-        };
+        Sha256Digest digest {};
+        for (std::size_t i = 0; i < 8; ++i) {
+            digest[i * 4 + 0] = static_cast<std::uint8_t>((state_[i] >> 24) & 0xFF);
+            digest[i * 4 + 1] = static_cast<std::uint8_t>((state_[i] >> 16) & 0xFF);
+            digest[i * 4 + 2] = static_cast<std::uint8_t>((state_[i] >> 8) & 0xFF);
+            digest[i * 4 + 3] = static_cast<std::uint8_t>(state_[i] & 0xFF);
+        }
+        return digest;
     }
 
-    std::optional<std::string> compute_sha256(const std::filesystem::path& path) {
-        std::ifstream file(path, std::ios::binary);
-        if (!file) {
-            return std::nullopt;
+    void Sha256::process_block(const std::uint8_t* block) {
+        static const std::uint32_t k[64] = {
+            0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+            0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+            0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+            0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+            0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+            0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+            0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+            0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U};
+
+        std::uint32_t w[64];
+        for (std::size_t i = 0; i < 16; ++i) {
+            w[i] = (static_cast<std::uint32_t>(block[i * 4 + 0]) << 24) |
+                (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16) |
+                (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8) |
+                (static_cast<std::uint32_t>(block[i * 4 + 3]));
+        }
+        for (std::size_t i = 16; i < 64; ++i) {
+            std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
         }
 
-        Sha256 hasher;
-        std::array<std::uint8_t, 1 << 15> buffer {};
+        std::uint32_t a = state_[0];
+        std::uint32_t b = state_[1];
+        std::uint32_t c = state_[2];
+        std::uint32_t d = state_[3];
+        std::uint32_t e = state_[4];
+        std::uint32_t f = state_[5];
+        std::uint32_t g = state_[6];
+        std::uint32_t h = state_[7];
 
-        while (file) {
-            file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
-            std::streamsize bytes_read = file.gcount();
-            if (bytes_read > 0) {
-                hasher.update(buffer.data(), static_cast<std::size_t>(bytes_read));
-            }
-        }
+        for (std::size_t i = 0; i < 64; ++i) {
+            std::uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            std::uint32_t ch = (e & f) ^ ((~e) & g);
+            std::uint32_t temp1 = h + s1 + ch + k[i] + w[i];
+            std::uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            std::uint32_t temp2 = s0 + maj;
 
-        if (!file.eof()) {
-            return std::nullopt;
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
         }
 
-        auto digest = hasher.finalize();
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+        state_[4] += e;
+        state_[5] += f;
+        state_[6] += g;
+        state_[7] += h;
+    }
+
+    std::string to_hex(const Sha256Digest& digest) {
         std::ostringstream oss;
         oss << std::hex << std::setfill('0');
         for (std::uint8_t byte : digest) {
@@ -175,4 +265,120 @@ namespace file_probe {
         }
         return oss.str();
     }
+
+    std::optional<Sha256Digest> compute_sha256_digest(const std::filesystem::path& path, uintmax_t* bytes_hashed) {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::nullopt;
+        }
+        auto digest = compute_sha256_digest(fd, bytes_hashed);
+        close(fd);
+        return digest;
+    }
+
+    std::optional<Sha256Digest> compute_sha256_digest(int fd, uintmax_t* bytes_hashed) {
+        ReadBuffer buffer = acquire_read_buffer();
+        if (!buffer || lseek(fd, 0, SEEK_SET) != 0) {
+            return std::nullopt;
+        }
+
+        struct stat file_info {};
+        struct statfs fs_info {};
+        const bool has_file_info = fstat(fd, &file_info) == 0;
+        const bool has_fs_info = fstatfs(fd, &fs_info) == 0;
+
+        const ReadDefaults defaults = has_fs_info ? defaults_for_filesystem(fs_info.f_type) : kGenericDefaults;
+        const std::size_t block_size = has_file_info && file_info.st_blksize > 0
+            ? static_cast<std::size_t>(file_info.st_blksize)
+            : kMinChunk;
+        const dev_t device = has_file_info ? file_info.st_dev : 0;
+
+        std::size_t chunk = clamp_chunk(learned_chunk(device).value_or(defaults.chunk), block_size, buffer.size());
+        const std::size_t initial_chunk = chunk;
+        std::size_t readahead = std::max(defaults.readahead, chunk * kReadaheadChunks);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        Sha256 hasher;
+        ThroughputTuner tuner(chunk, buffer.size());
+        off_t offset = 0;
+        off_t advised_until = 0;
+        bool read_failed = false;
+        const auto started = std::chrono::steady_clock::now();
+
+        while (true) {
+            if (offset + static_cast<off_t>(chunk) > advised_until) {
+                posix_fadvise(fd, offset, static_cast<off_t>(readahead), POSIX_FADV_WILLNEED);
+                advised_until = offset + static_cast<off_t>(readahead);
+            }
+
+            ssize_t bytes_read = read(fd, buffer.data(), chunk);
+            if (bytes_read < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                read_failed = true;
+                break;
+            }
+            if (bytes_read == 0) {
+                break;
+            }
+
+            hasher.update(buffer.data(), static_cast<std::size_t>(bytes_read));
+            offset += bytes_read;
+
+            if (auto next = tuner.record(static_cast<std::size_t>(bytes_read))) {
+                chunk = clamp_chunk(*next, block_size, buffer.size());
+                readahead = std::max(defaults.readahead, chunk * kReadaheadChunks);
+            }
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        if (read_failed) {
+            return std::nullopt;
+        }
+
+        if (tuner.settled()) {
+            remember_chunk(device, chunk);
+        }
+
+        if (PhaseRecorder* recorder = active_phase_recorder()) {
+            ReadProfile profile;
+            profile.filesystem = defaults.name;
+            profile.block_size = block_size;
+            profile.initial_chunk = initial_chunk;
+            profile.final_chunk = chunk;
+            profile.readahead = readahead;
+            profile.bytes_read = static_cast<uintmax_t>(offset);
+            profile.seconds = seconds;
+            recorder->set_read_profile(std::move(profile));
+        }
+
+        if (bytes_hashed) {
+            *bytes_hashed = static_cast<uintmax_t>(offset);
+        }
+        return hasher.finalize();
+    }
+
+    std::optional<std::string> compute_sha256(const std::filesystem::path& path, uintmax_t* bytes_hashed) {
+        auto digest = compute_sha256_digest(path, bytes_hashed);
+        if (!digest) {
+            return std::nullopt;
+        }
+        return to_hex(*digest);
+    }
+
+    std::optional<std::string> compute_sha256(int fd, uintmax_t* bytes_hashed) {
+        auto digest = compute_sha256_digest(fd, bytes_hashed);
+        if (!digest) {
+            return std::nullopt;
+        }
+        return to_hex(*digest);
+    }
+
+    std::string sha256_hex(const std::uint8_t* data, std::size_t length) {
+        Sha256 hasher;
+        hasher.update(data, length);
+        return to_hex(hasher.finalize());
+    }
 }
@@ -0,0 +1,236 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include "file_probe/hashset.hpp"
+#include "file_probe/binary_io.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr char kMagic[8] = {'F', 'P', 'H', 'S', 'E', 'T', '\0', '\1'};
+        constexpr std::size_t kHeaderSize = 64;
+        constexpr std::size_t kBlockBytes = 64;
+        constexpr std::size_t kBitsPerKey = 10;
+        constexpr unsigned kProbesPerKey = 6;
+        constexpr std::size_t kDigestBytes = sizeof(Sha256Digest);
+
+        __extension__ typedef unsigned __int128 Uint128;
+
+        // Digests are uniformly distributed, so their bytes serve directly as
+        // hash values: bytes 0-7 order the sorted table, 8-15 pick the Bloom
+        // block and 16-23 the bits inside it.
+        std::uint64_t big_endian_u64(const std::uint8_t* bytes) {
+            std::uint64_t value = 0;
+            for (int index = 0; index < 8; ++index) {
+                value = (value << 8) | bytes[index];
+            }
+            return value;
+        }
+
+        std::uint64_t little_endian_u64(const std::uint8_t* bytes) {
+            std::uint64_t value = 0;
+            for (int index = 7; index >= 0; --index) {
+                value = (value << 8) | bytes[index];
+            }
+            return value;
+        }
+
+        std::uint64_t block_index(const std::uint8_t* digest, std::uint64_t blocks) {
+            return static_cast<std::uint64_t>(
+                (static_cast<Uint128>(big_endian_u64(digest + 8)) * blocks) >> 64);
+        }
+
+        template <typename Visit>
+        void for_each_bloom_bit(const std::uint8_t* digest, Visit visit) {
+            std::uint64_t bits = big_endian_u64(digest + 16);
+            for (unsigned probe = 0; probe < kProbesPerKey; ++probe) {
+                visit(static_cast<unsigned>(bits & 511));
+                bits >>= 9;
+            }
+        }
+
+        int hex_value(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool parse_hex_digest(std::string_view hex, Sha256Digest& digest) {
+            if (hex.size() != kDigestBytes * 2) {
+                return false;
+            }
+            for (std::size_t index = 0; index < kDigestBytes; ++index) {
+                const int high = hex_value(hex[2 * index]);
+                const int low = hex_value(hex[2 * index + 1]);
+                if (high < 0 || low < 0) {
+                    return false;
+                }
+                digest[index] = static_cast<std::uint8_t>((high << 4) | low);
+            }
+            return true;
+        }
+    }
+
+    HashSet::~HashSet() {
+        if (mapping_) {
+            munmap(mapping_, mapping_size_);
+        }
+    }
+
+    std::shared_ptr<const HashSet> HashSet::open(const std::string& path, std::string& error) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "Unable to open " + path + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < kHeaderSize) {
+            ::close(fd);
+            error = path + " is not a hash set file";
+            return nullptr;
+        }
+
+        std::shared_ptr<HashSet> set(new HashSet());
+        set->mapping_size_ = static_cast<std::size_t>(info.st_size);
+        void* mapping = mmap(nullptr, set->mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = "Unable to map " + path + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        set->mapping_ = mapping;
+
+        const auto* bytes = static_cast<const std::uint8_t*>(mapping);
+        const std::uint64_t count = little_endian_u64(bytes + 8);
+        const std::uint64_t blocks = little_endian_u64(bytes + 16);
+        const std::size_t available = set->mapping_size_ - kHeaderSize;
+        if (std::memcmp(bytes, kMagic, sizeof(kMagic)) != 0 || blocks == 0 ||
+            blocks > available / kBlockBytes || count > (available - blocks * kBlockBytes) / kDigestBytes ||
+            kHeaderSize + blocks * kBlockBytes + count * kDigestBytes != set->mapping_size_) {
+            error = path + " is not a hash set file (use --build-hashset to convert text lists)";
+            return nullptr;
+        }
+
+        set->bloom_ = bytes + kHeaderSize;
+        set->bloom_blocks_ = blocks;
+        set->digests_ = set->bloom_ + blocks * kBlockBytes;
+        set->count_ = static_cast<std::size_t>(count);
+        // Lookups jump around the table, so readahead would only waste I/O.
+        madvise(mapping, set->mapping_size_, MADV_RANDOM);
+        return set;
+    }
+
+    bool HashSet::maybe_contains(const Sha256Digest& digest) const {
+        const std::uint8_t* block = bloom_ + block_index(digest.data(), bloom_blocks_) * kBlockBytes;
+        bool present = true;
+        for_each_bloom_bit(digest.data(), [&](unsigned bit) {
+            present = present && (block[bit >> 3] & (1u << (bit & 7)));
+        });
+        return present;
+    }
+
+    bool HashSet::contains(const Sha256Digest& digest) const {
+        if (count_ == 0 || !maybe_contains(digest)) {
+            return false;
+        }
+
+        const std::uint64_t key = big_endian_u64(digest.data());
+        auto key_at = [&](std::size_t index) { return big_endian_u64(digests_ + index * kDigestBytes); };
+
+        std::size_t low = 0;
+        std::size_t high = count_ - 1;
+        // Interpolation converges in O(log log n) probes on uniform keys; fall
+        // back to bisection if a skewed list keeps it from narrowing quickly.
+        for (unsigned steps = 0; low <= high; ++steps) {
+            const std::uint64_t low_key = key_at(low);
+            const std::uint64_t high_key = key_at(high);
+            if (key < low_key || key > high_key) {
+                return false;
+            }
+            std::size_t probe = low + (high - low) / 2;
+            if (steps < 16 && high_key > low_key) {
+                probe = low + static_cast<std::size_t>(
+                    static_cast<Uint128>(key - low_key) * (high - low) / (high_key - low_key));
+            }
+            const int order = std::memcmp(digests_ + probe * kDigestBytes, digest.data(), kDigestBytes);
+            if (order == 0) {
+                return true;
+            }
+            if (order < 0) {
+                low = probe + 1;
+            } else {
+                if (probe == 0) {
+                    return false;
+                }
+                high = probe - 1;
+            }
+        }
+        return false;
+    }
+
+    bool HashSet::contains_hex(std::string_view hex) const {
+        Sha256Digest digest {};
+        return parse_hex_digest(hex, digest) && contains(digest);
+    }
+
+    bool build_hashset(const std::vector<std::string>& inputs, const std::string& output,
+                       HashSetBuildResult& result, std::string& error) {
+        std::vector<Sha256Digest> digests;
+        for (const auto& input : inputs) {
+            std::ifstream stream(input);
+            if (!stream) {
+                error = "Unable to read " + input;
+                return false;
+            }
+            std::string line;
+            while (std::getline(stream, line)) {
+                const auto start = line.find_first_not_of(" \t\r");
+                if (start == std::string::npos || line[start] == '#') {
+                    continue;
+                }
+                const auto end = line.find_first_of(" \t\r", start);
+                Sha256Digest digest {};
+                if (parse_hex_digest(std::string_view(line).substr(start, end == std::string::npos ? end : end - start), digest)) {
+                    digests.push_back(digest);
+                } else {
+                    ++result.invalid_lines;
+                }
+            }
+        }
+
+        std::sort(digests.begin(), digests.end());
+        const auto unique_end = std::unique(digests.begin(), digests.end());
+        result.duplicates = static_cast<std::size_t>(digests.end() - unique_end);
+        digests.erase(unique_end, digests.end());
+        result.digests = digests.size();
+
+        const std::uint64_t blocks = std::max<std::uint64_t>(1, (digests.size() * kBitsPerKey + kBlockBytes * 8 - 1) / (kBlockBytes * 8));
+        std::string bloom(blocks * kBlockBytes, '\0');
+        for (const auto& digest : digests) {
+            char* block = bloom.data() + block_index(digest.data(), blocks) * kBlockBytes;
+            for_each_bloom_bit(digest.data(), [&](unsigned bit) {
+                block[bit >> 3] = static_cast<char>(block[bit >> 3] | (1u << (bit & 7)));
+            });
+        }
+
+        // Only the header is encoded; the Bloom blocks and the sorted digests
+        // are written from where they already sit.
+        BinaryWriter header;
+        header.put_bytes(kMagic, sizeof(kMagic));
+        header.put_u64(digests.size());
+        header.put_u64(blocks);
+        header.put_u32(kProbesPerKey);
+        header.put_u32(static_cast<std::uint32_t>(kBitsPerKey));
+        const std::string padding(kHeaderSize - header.data().size(), '\0');
+        header.put_bytes(padding.data(), padding.size());
+        return write_binary_file(output,
+                                 {header.data(), bloom,
+                                  std::string_view(reinterpret_cast<const char*>(digests.data()), digests.size() * kDigestBytes)},
+                                 error);
+    }
+}
@@ -0,0 +1,146 @@
+#include <mutex>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/sysmacros.h>
+#include <thread>
+#include <condition_variable>
+#include "file_probe/io_watchdog.hpp"
+
+namespace file_probe {
+
+    // Shared between the walker and the worker thread; an abandoned worker
+    // keeps it alive until its blocked call finally returns.
+    struct IoWatchdog::Worker {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        Call call;
+        bool pending = false;
+        bool finished = false;
+        bool succeeded = false;
+        bool stopping = false;
+        bool stalled = false;
+        std::thread thread;
+
+        static void run(std::shared_ptr<Worker> self) {
+            std::unique_lock<std::mutex> lock(self->mutex);
+            while (true) {
+                self->wake.wait(lock, [&] { return self->pending || self->stopping; });
+                if (self->stopping) {
+                    return;
+                }
+                Call call = std::move(self->call);
+                self->call = nullptr;
+                lock.unlock();
+                const bool succeeded = call();
+                // Releases what the call owned (an abandoned call's open files
+                // included) before anyone is told it finished.
+                call = nullptr;
+                lock.lock();
+                if (self->stalled) {
+                    return;
+                }
+                self->succeeded = succeeded;
+                self->pending = false;
+                self->finished = true;
+                self->done.notify_one();
+            }
+        }
+
+        void stop() {
+            if (stalled) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+    };
+
+    IoWatchdog::IoWatchdog(std::chrono::milliseconds timeout) : timeout_(timeout) {}
+
+    IoWatchdog::~IoWatchdog() {
+        for (auto& [device, worker] : workers_) {
+            worker->stop();
+        }
+        if (unbound_) {
+            unbound_->stop();
+        }
+    }
+
+    IoWatchdog::Outcome IoWatchdog::run(dev_t device, Call call) {
+        return dispatch(workers_[device], std::move(call));
+    }
+
+    IoWatchdog::Outcome IoWatchdog::run_unbound(Call call) {
+        if (unbound_ && unbound_->stalled) {
+            unbound_.reset();
+        }
+        return dispatch(unbound_, std::move(call));
+    }
+
+    IoWatchdog::Outcome IoWatchdog::dispatch(std::shared_ptr<Worker>& worker, Call call) {
+        if (!worker) {
+            worker = std::make_shared<Worker>();
+            worker->thread = std::thread(Worker::run, worker);
+        }
+        if (worker->stalled) {
+            return Outcome::Stalled;
+        }
+
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        worker->call = std::move(call);
+        worker->finished = false;
+        worker->pending = true;
+        worker->wake.notify_one();
+        if (!worker->done.wait_for(lock, timeout_, [&] { return worker->finished; })) {
+            worker->stalled = true;
+            worker->thread.detach();
+            return Outcome::Stalled;
+        }
+        return worker->succeeded ? Outcome::Ok : Outcome::Failed;
+    }
+
+    bool IoWatchdog::is_stalled(dev_t device) const {
+        auto found = workers_.find(device);
+        return found != workers_.end() && found->second->stalled;
+    }
+
+    std::unordered_map<std::string, dev_t> mount_point_devices() {
+        std::unordered_map<std::string, dev_t> devices;
+        std::ifstream mountinfo("/proc/self/mountinfo");
+        std::string line;
+        while (std::getline(mountinfo, line)) {
+            // "id parent major:minor root mount-point ..."; later lines are
+            // mounted on top of earlier ones at the same point.
+            std::istringstream fields(line);
+            std::string id, parent, numbers, root, mount_point;
+            if (!(fields >> id >> parent >> numbers >> root >> mount_point)) {
+                continue;
+            }
+            unsigned int major_number = 0;
+            unsigned int minor_number = 0;
+            if (std::sscanf(numbers.c_str(), "%u:%u", &major_number, &minor_number) != 2) {
+                continue;
+            }
+            // Spaces, tabs, newlines and backslashes are octal-escaped.
+            std::string decoded;
+            for (std::size_t index = 0; index < mount_point.size(); ++index) {
+                if (mount_point[index] == '\\' && index + 3 < mount_point.size() &&
+                    std::isdigit(static_cast<unsigned char>(mount_point[index + 1]))) {
+                    decoded.push_back(static_cast<char>(std::stoi(mount_point.substr(index + 1, 3), nullptr, 8)));
+                    index += 3;
+                } else {
+                    decoded.push_back(mount_point[index]);
+                }
+            }
+            devices[decoded] = makedev(major_number, minor_number);
+        }
+        return devices;
+    }
+}
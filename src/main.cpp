@@ -1,9 +1,15 @@
+#include <optional>
 #include <iostream>
 #include <filesystem>
 #include "file_probe/cli.hpp"
+#include "file_probe/shard.hpp"
+#include "file_probe/hashset.hpp"
 #include "file_probe/utils.hpp"
 #include "file_probe/render.hpp"
+#include "file_probe/timings.hpp"
 #include "file_probe/collector.hpp"
+#include "file_probe/scheduling.hpp"
+#include "file_probe/sqlite_inventory.hpp"
 
 int main(int argc, char* argv[]) {
     auto options = file_probe::parse_cli(argc, argv);
@@ -23,8 +29,48 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    const std::filesystem::path target_path = *options.path;
-    file_probe::FileReport report = file_probe::collect_file_report(target_path);
+    if (options.build_hashset) {
+        file_probe::HashSetBuildResult built;
+        std::string build_error;
+        if (!file_probe::build_hashset(options.input_files, *options.build_hashset, built, build_error)) {
+            std::cerr << "\033[1;31mError: " << build_error << "\033[0m\n";
+            return 1;
+        }
+        std::cout << "Wrote " << built.digests << " digests to " << *options.build_hashset
+                  << " (" << built.duplicates << " duplicates, " << built.invalid_lines << " invalid lines skipped)\n";
+        return 0;
+    }
+
+    const auto scheduling_warnings = file_probe::apply_scheduling(options.scheduling);
+
+    file_probe::PhaseRecorder recorder;
+    file_probe::PerfCounters perf_counters;
+    std::optional<std::string> perf_warning;
+    if (options.perf_counters) {
+        perf_warning = perf_counters.open();
+        recorder.attach_perf_counters(&perf_counters);
+    }
+    if (options.show_timings) {
+        file_probe::install_phase_recorder(&recorder);
+    }
+
+    file_probe::FileReport report;
+    if (options.merge) {
+        std::string merge_error;
+        auto merged = file_probe::merge_partials(options.input_files, merge_error);
+        if (!merged) {
+            std::cerr << "\033[1;31mError: " << merge_error << "\033[0m\n";
+            return 1;
+        }
+        report = std::move(*merged);
+    } else {
+        const std::filesystem::path target_path = *options.path;
+        report = file_probe::collect_file_report(target_path, options.probe);
+    }
+    report.warnings.insert(report.warnings.end(), scheduling_warnings.begin(), scheduling_warnings.end());
+    if (perf_warning) {
+        report.warnings.push_back(*perf_warning);
+    }
 
     if (!report.target_exists && !report.symlink.is_symlink) {
         if (options.json_output) {
@@ -38,10 +84,40 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    if (options.json_output) {
-        file_probe::render_json(report);
+    if (options.partial_output) {
+        std::string partial_error;
+        const file_probe::ShardSpec shard = options.probe.shard.value_or(file_probe::ShardSpec{});
+        if (!file_probe::write_partial(*options.partial_output, report, shard, partial_error)) {
+            std::cerr << "\033[1;31mError: " << partial_error << "\033[0m\n";
+            return 1;
+        }
+    } else if (options.sqlite_output) {
+        file_probe::ScopedPhase phase(file_probe::Phase::Render);
+        std::string sqlite_error;
+        if (!file_probe::write_sqlite_inventory(*options.sqlite_output, report, sqlite_error)) {
+            std::cerr << "\033[1;31mError: " << sqlite_error << "\033[0m\n";
+            return 1;
+        }
     } else {
-        file_probe::render_text(report);
+        file_probe::ScopedPhase phase(file_probe::Phase::Render);
+        if (options.table_output) {
+            file_probe::render_table(report, options.fixed_widths);
+        } else if (options.output_template) {
+            file_probe::render_template(report, *options.output_template);
+        } else if (options.json_output) {
+            file_probe::render_json(report);
+        } else {
+            file_probe::render_text(report);
+        }
+        std::cout.flush();
+    }
+
+    if (options.show_timings) {
+        if (options.json_output) {
+            file_probe::render_timings_json(recorder);
+        } else {
+            file_probe::render_timings_text(recorder);
+        }
     }
 
     return 0;
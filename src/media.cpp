@@ -1,6 +1,7 @@
 #include <array>
 #include <cctype>
 #include <memory>
+#include <chrono>
 #include <vector>
 #include <sstream>
 #include <cstring>
@@ -8,12 +9,7 @@
 #include <algorithm>
 #include <string_view>
 #include "file_probe/media.hpp"
-
-extern "C" {
-    #include <libavutil/avutil.h>
-    #include <libavcodec/avcodec.h>
-    #include <libavformat/avformat.h>
-}
+#include "file_probe/ffmpeg_api.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "include/others/stb_image.h"
@@ -45,12 +41,14 @@ namespace file_probe {
         }
 
         struct FormatContextDeleter {
+            const FfmpegApi* api = nullptr;
+
             void operator()(AVFormatContext* ctx) const noexcept {
                 if (!ctx) {
                     return;
                 }
                 AVFormatContext* to_close = ctx;
-                avformat_close_input(&to_close);
+                api->close_input(&to_close);
             }
         };
 
@@ -64,18 +62,139 @@ namespace file_probe {
 #endif
         }
 
-        FormatContextPtr open_media_file(const Path& path) {
-            AVFormatContext* raw = nullptr;
+        using Deadline = std::chrono::steady_clock::time_point;
+
+        // Polled by FFmpeg's blocking I/O and demuxer loops; a non-zero return
+        // aborts the current call with AVERROR_EXIT.
+        int deadline_reached(void* opaque) {
+            const auto* deadline = static_cast<const Deadline*>(opaque);
+            return std::chrono::steady_clock::now() >= *deadline ? 1 : 0;
+        }
+
+        FormatContextPtr open_media_file(const FfmpegApi* api, const Path& path, const Deadline* deadline) {
+            AVFormatContext* raw = api->alloc_context();
+            if (!raw) {
+                return nullptr;
+            }
+            if (deadline) {
+                raw->interrupt_callback.callback = deadline_reached;
+                raw->interrupt_callback.opaque = const_cast<Deadline*>(deadline);
+            }
             const std::string native_path = to_utf8_path(path);
-            if (avformat_open_input(&raw, native_path.c_str(), nullptr, nullptr) != 0) {
+            // avformat_open_input frees the context itself on failure.
+            if (api->open_input(&raw, native_path.c_str(), nullptr, nullptr) != 0) {
                 return nullptr;
             }
-            FormatContextPtr context(raw);
-            if (avformat_find_stream_info(context.get(), nullptr) < 0) {
+            FormatContextPtr context(raw, FormatContextDeleter {api});
+            if (api->find_stream_info(context.get(), nullptr) < 0) {
                 return nullptr;
             }
             return context;
         }
+
+        std::optional<std::string> read_resolution(const AVFormatContext* context) {
+            const AVStream* stream = nullptr;
+            for (unsigned int idx = 0; idx < context->nb_streams; ++idx) {
+                const AVStream* candidate = context->streams[idx];
+                if (candidate->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                    stream = candidate;
+                    break;
+                }
+            }
+
+            if (!stream) {
+                return std::nullopt;
+            }
+
+            int width = stream->codecpar->width;
+            int height = stream->codecpar->height;
+            if (width <= 0 || height <= 0) {
+                return std::nullopt;
+            }
+
+            return std::to_string(width) + "x" + std::to_string(height);
+        }
+
+        std::optional<std::string> read_metadata(const FfmpegApi* api, const AVFormatContext* context) {
+            std::ostringstream oss;
+            bool has_value = false;
+
+            if (context->iformat && context->iformat->name) {
+                oss << "Format: " << context->iformat->name;
+                has_value = true;
+            }
+
+            if (context->bit_rate > 0) {
+                if (has_value) {
+                    oss << " | ";
+                }
+                double rate = static_cast<double>(context->bit_rate);
+                const char* units[] = {"b/s", "kb/s", "Mb/s", "Gb/s"};
+                int unit_index = 0;
+                while (rate >= 1000.0 && unit_index < 3) {
+                    rate /= 1000.0;
+                    ++unit_index;
+                }
+                oss << "Bitrate: " << std::fixed << std::setprecision(rate < 10.0 ? 2 : (rate < 100.0 ? 1 : 0))
+                    << rate << ' ' << units[unit_index];
+                has_value = true;
+            }
+
+            std::vector<std::string> codecs;
+            for (unsigned int idx = 0; idx < context->nb_streams; ++idx) {
+                const AVStream* stream = context->streams[idx];
+                if (stream->codecpar) {
+                    const char* codec_name = api->codec_name(stream->codecpar->codec_id);
+                    if (codec_name && std::strlen(codec_name) > 0) {
+                        codecs.emplace_back(codec_name);
+                    }
+                }
+            }
+
+            if (!codecs.empty()) {
+                if (has_value) {
+                    oss << " | ";
+                }
+                oss << "Codec: ";
+                for (std::size_t i = 0; i < codecs.size(); ++i) {
+                    if (i > 0) {
+                        oss << ", ";
+                    }
+                    oss << codecs[i];
+                }
+                has_value = true;
+            }
+
+            if (!has_value) {
+                return std::nullopt;
+            }
+
+            return oss.str();
+        }
+
+        std::optional<std::string> read_duration(const AVFormatContext* context) {
+            if (context->duration == AV_NOPTS_VALUE || context->duration <= 0) {
+                return std::nullopt;
+            }
+
+            const double total_seconds = static_cast<double>(context->duration) / AV_TIME_BASE;
+            const int hours = static_cast<int>(total_seconds) / 3600;
+            const int minutes = (static_cast<int>(total_seconds) % 3600) / 60;
+            const int seconds = static_cast<int>(total_seconds) % 60;
+
+            std::ostringstream oss;
+            if (hours > 0) {
+                oss << hours << " hours ";
+            }
+            if (minutes > 0) {
+                oss << minutes << " minutes ";
+            }
+            if (seconds > 0 || (hours == 0 && minutes == 0)) {
+                oss << seconds << " seconds";
+            }
+
+            return oss.str();
+        }
     }
 
     bool is_image_extension(const Path& path) {
@@ -114,122 +233,49 @@ namespace file_probe {
         return oss.str();
     }
 
-    std::optional<std::string> media_resolution(const Path& path) {
-        auto context = open_media_file(path);
-        if (!context) {
-            return std::nullopt;
-        }
-
-        const AVStream* stream = nullptr;
-        for (unsigned int idx = 0; idx < context->nb_streams; ++idx) {
-            const AVStream* candidate = context->streams[idx];
-            if (candidate->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                stream = candidate;
-                break;
-            }
-        }
-
-        if (!stream) {
-            return std::nullopt;
-        }
-
-        int width = stream->codecpar->width;
-        int height = stream->codecpar->height;
-        if (width <= 0 || height <= 0) {
+    std::optional<std::string> image_resolution(const std::uint8_t* data, std::size_t length) {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        if (stbi_info_from_memory(data, static_cast<int>(length), &width, &height, &channels) == 0) {
             return std::nullopt;
         }
-
         return std::to_string(width) + "x" + std::to_string(height);
     }
 
-    std::optional<std::string> media_metadata(const Path& path) {
-        auto context = open_media_file(path);
-        if (!context) {
+    std::optional<std::string> image_metadata(const std::uint8_t* data, std::size_t length) {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        if (stbi_info_from_memory(data, static_cast<int>(length), &width, &height, &channels) == 0) {
             return std::nullopt;
         }
-
         std::ostringstream oss;
-        bool has_value = false;
-
-        if (context->iformat && context->iformat->name) {
-            oss << "Format: " << context->iformat->name;
-            has_value = true;
-        }
-
-        if (context->bit_rate > 0) {
-            if (has_value) {
-                oss << " | ";
-            }
-            double rate = static_cast<double>(context->bit_rate);
-            const char* units[] = {"b/s", "kb/s", "Mb/s", "Gb/s"};
-            int unit_index = 0;
-            while (rate >= 1000.0 && unit_index < 3) {
-                rate /= 1000.0;
-                ++unit_index;
-            }
-            oss << "Bitrate: " << std::fixed << std::setprecision(rate < 10.0 ? 2 : (rate < 100.0 ? 1 : 0))
-                << rate << ' ' << units[unit_index];
-            has_value = true;
-        }
-
-        std::vector<std::string> codecs;
-        for (unsigned int idx = 0; idx < context->nb_streams; ++idx) {
-            const AVStream* stream = context->streams[idx];
-            if (stream->codecpar) {
-                const char* codec_name = avcodec_get_name(stream->codecpar->codec_id);
-                if (codec_name && std::strlen(codec_name) > 0) {
-                    codecs.emplace_back(codec_name);
-                }
-            }
-        }
-
-        if (!codecs.empty()) {
-            if (has_value) {
-                oss << " | ";
-            }
-            oss << "Codec: ";
-            for (std::size_t i = 0; i < codecs.size(); ++i) {
-                if (i > 0) {
-                    oss << ", ";
-                }
-                oss << codecs[i];
-            }
-            has_value = true;
-        }
-
-        if (!has_value) {
-            return std::nullopt;
-        }
-
+        oss << "Channels: " << channels;
         return oss.str();
     }
 
-    std::optional<std::string> media_duration(const Path& path) {
-        auto context = open_media_file(path);
-        if (!context) {
-            return std::nullopt;
+    MediaProbe probe_media(const Path& path, std::chrono::milliseconds timeout) {
+        MediaProbe probe;
+        const FfmpegApi* api = ffmpeg_api(probe.error);
+        if (!api) {
+            return probe;
         }
 
-        if (context->duration == AV_NOPTS_VALUE || context->duration <= 0) {
-            return std::nullopt;
+        std::optional<Deadline> deadline;
+        if (timeout.count() > 0) {
+            deadline = std::chrono::steady_clock::now() + timeout;
         }
-
-        const double total_seconds = static_cast<double>(context->duration) / AV_TIME_BASE;
-        const int hours = static_cast<int>(total_seconds) / 3600;
-        const int minutes = (static_cast<int>(total_seconds) % 3600) / 60;
-        const int seconds = static_cast<int>(total_seconds) % 60;
-
-        std::ostringstream oss;
-        if (hours > 0) {
-            oss << hours << " hours ";
-        }
-        if (minutes > 0) {
-            oss << minutes << " minutes ";
-        }
-        if (seconds > 0 || (hours == 0 && minutes == 0)) {
-            oss << seconds << " seconds";
+        auto context = open_media_file(api, path, deadline ? &*deadline : nullptr);
+        if (!context) {
+            probe.timed_out = deadline && std::chrono::steady_clock::now() >= *deadline;
+            return probe;
         }
 
-        return oss.str();
+        probe.opened = true;
+        probe.resolution = read_resolution(context.get());
+        probe.metadata = read_metadata(api, context.get());
+        probe.duration = read_duration(context.get());
+        return probe;
     }
 }
@@ -0,0 +1,61 @@
+#include <cerrno>
+#include <charconv>
+#include <unistd.h>
+#include "file_probe/output_buffer.hpp"
+
+namespace file_probe {
+
+    OutputBuffer::OutputBuffer(int fd, std::size_t capacity) : fd_(fd), capacity_(capacity) {
+        buffer_.reserve(capacity_);
+    }
+
+    OutputBuffer::~OutputBuffer() {
+        flush();
+    }
+
+    void OutputBuffer::reserve(std::size_t length) {
+        if (buffer_.size() + length > capacity_) {
+            flush();
+        }
+    }
+
+    void OutputBuffer::append(std::string_view text) {
+        reserve(text.size());
+        buffer_.append(text.data(), text.size());
+    }
+
+    void OutputBuffer::append(char c) {
+        reserve(1);
+        buffer_.push_back(c);
+    }
+
+    void OutputBuffer::append_number(std::uintmax_t value) {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        append(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+    }
+
+    void OutputBuffer::append_padding(char c, std::size_t count) {
+        reserve(count);
+        buffer_.append(count, c);
+    }
+
+    bool OutputBuffer::flush() {
+        const char* data = buffer_.data();
+        std::size_t remaining = ok_ ? buffer_.size() : 0;
+        while (remaining > 0) {
+            const ssize_t written = ::write(fd_, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ok_ = false;
+                break;
+            }
+            data += written;
+            remaining -= static_cast<std::size_t>(written);
+        }
+        buffer_.clear();
+        return ok_;
+    }
+}
@@ -0,0 +1,265 @@
+#include <array>
+#include <algorithm>
+#include <string_view>
+#include "file_probe/utils.hpp"
+#include "file_probe/output_template.hpp"
+
+namespace file_probe {
+
+    namespace {
+        struct FieldName {
+            std::string_view name;
+            TemplateField field;
+        };
+
+        constexpr std::array<FieldName, 18> kFieldNames {{
+            {"path", TemplateField::Path},
+            {"name", TemplateField::Name},
+            {"type", TemplateField::Type},
+            {"size", TemplateField::Size},
+            {"size_human", TemplateField::SizeHuman},
+            {"sha256", TemplateField::Sha256},
+            {"mode", TemplateField::Mode},
+            {"owner", TemplateField::Owner},
+            {"group", TemplateField::Group},
+            {"atime", TemplateField::Atime},
+            {"mtime", TemplateField::Mtime},
+            {"ctime", TemplateField::Ctime},
+            {"target", TemplateField::Target},
+            {"resolution", TemplateField::Resolution},
+            {"duration", TemplateField::Duration},
+            {"metadata", TemplateField::Metadata},
+            {"files", TemplateField::Files},
+            {"dirs", TemplateField::Dirs}
+        }};
+
+        struct FieldValue {
+            enum class Kind {
+                Missing,
+                Text,
+                Number
+            };
+
+            Kind kind = Kind::Missing;
+            std::string_view text;
+            std::uintmax_t number = 0;
+
+            static FieldValue of(std::string_view value) { return {Kind::Text, value, 0}; }
+            static FieldValue of(std::uintmax_t value) { return {Kind::Number, {}, value}; }
+            static FieldValue of(const std::optional<std::string>& value) {
+                return value ? of(std::string_view(*value)) : FieldValue {};
+            }
+        };
+
+        std::string_view base_name(std::string_view path) {
+            while (path.size() > 1 && path.back() == '/') {
+                path.remove_suffix(1);
+            }
+            const auto slash = path.rfind('/');
+            return slash == std::string_view::npos || path.size() == 1 ? path : path.substr(slash + 1);
+        }
+
+        FieldValue field_value(const FileReport& report, TemplateField field, std::string&) {
+            const auto& file = report.file_detail;
+            const auto& directory = report.directory_detail;
+            switch (field) {
+                case TemplateField::Path: return FieldValue::of(std::string_view(report.absolute_path.native()));
+                case TemplateField::Name: return FieldValue::of(base_name(report.absolute_path.native()));
+                case TemplateField::Type: return FieldValue::of(std::string_view(report.type));
+                case TemplateField::Size:
+                    if (file) return FieldValue::of(file->size_bytes);
+                    if (directory) return FieldValue::of(directory->total_size_bytes);
+                    return {};
+                case TemplateField::SizeHuman:
+                    if (file) return FieldValue::of(std::string_view(file->size_human));
+                    if (directory) return FieldValue::of(std::string_view(directory->total_size_human));
+                    return {};
+                case TemplateField::Sha256:
+                    if (file && !file->checksum.empty()) return FieldValue::of(std::string_view(file->checksum));
+                    return {};
+                case TemplateField::Mode: return FieldValue::of(report.permissions);
+                case TemplateField::Owner:
+                    return report.ownership ? FieldValue::of(std::string_view(report.ownership->owner)) : FieldValue {};
+                case TemplateField::Group:
+                    return report.ownership ? FieldValue::of(std::string_view(report.ownership->group)) : FieldValue {};
+                case TemplateField::Atime:
+                    return report.timestamps ? FieldValue::of(std::string_view(report.timestamps->last_access)) : FieldValue {};
+                case TemplateField::Mtime:
+                    return report.timestamps ? FieldValue::of(std::string_view(report.timestamps->last_modify)) : FieldValue {};
+                case TemplateField::Ctime:
+                    return report.timestamps ? FieldValue::of(std::string_view(report.timestamps->last_change)) : FieldValue {};
+                case TemplateField::Target: return FieldValue::of(report.symlink.target);
+                case TemplateField::Resolution: return file ? FieldValue::of(file->resolution) : FieldValue {};
+                case TemplateField::Duration: return file ? FieldValue::of(file->duration) : FieldValue {};
+                case TemplateField::Metadata: return file ? FieldValue::of(file->metadata) : FieldValue {};
+                case TemplateField::Files: return directory ? FieldValue::of(directory->file_count) : FieldValue {};
+                case TemplateField::Dirs: return directory ? FieldValue::of(directory->directory_count) : FieldValue {};
+            }
+            return {};
+        }
+
+        FieldValue field_value(const MatchedEntry& entry, TemplateField field, std::string& scratch) {
+            switch (field) {
+                case TemplateField::Path: return FieldValue::of(std::string_view(entry.path));
+                case TemplateField::Name: return FieldValue::of(base_name(entry.path));
+                case TemplateField::Type: return FieldValue::of(std::string_view(entry.type));
+                case TemplateField::Size: return FieldValue::of(entry.size_bytes);
+                case TemplateField::SizeHuman:
+                    scratch = format_size(entry.size_bytes);
+                    return FieldValue::of(std::string_view(scratch));
+                default: return {};
+            }
+        }
+
+        bool is_shell_safe(unsigned char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                c == '_' || c == '-' || c == '.' || c == '/' || c == ',' || c == ':' || c == '=' ||
+                c == '+' || c == '@' || c == '%';
+        }
+
+        void append_escaped(std::string_view text, TemplateEscape escape, OutputBuffer& out) {
+            switch (escape) {
+                case TemplateEscape::Raw:
+                    out.append(text);
+                    return;
+                case TemplateEscape::Shell: {
+                    bool safe = !text.empty();
+                    for (unsigned char c : text) {
+                        safe = safe && is_shell_safe(c);
+                    }
+                    if (safe) {
+                        out.append(text);
+                        return;
+                    }
+                    out.append('\'');
+                    for (std::size_t start = 0;;) {
+                        const auto quote = text.find('\'', start);
+                        out.append(text.substr(start, quote - start));
+                        if (quote == std::string_view::npos) {
+                            break;
+                        }
+                        out.append("'\\''");
+                        start = quote + 1;
+                    }
+                    out.append('\'');
+                    return;
+                }
+                case TemplateEscape::Csv: {
+                    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+                        out.append(text);
+                        return;
+                    }
+                    out.append('"');
+                    for (std::size_t start = 0;;) {
+                        const auto quote = text.find('"', start);
+                        out.append(text.substr(start, quote - start));
+                        if (quote == std::string_view::npos) {
+                            break;
+                        }
+                        out.append("\"\"");
+                        start = quote + 1;
+                    }
+                    out.append('"');
+                    return;
+                }
+            }
+        }
+
+        std::optional<char> unescape(char c) {
+            switch (c) {
+                case 't': return '\t';
+                case 'n': return '\n';
+                case 'r': return '\r';
+                case '0': return '\0';
+                case '\\': return '\\';
+                default: return std::nullopt;
+            }
+        }
+    }
+
+    std::optional<TemplateEscape> parse_template_escape(const std::string& value) {
+        if (value == "raw") return TemplateEscape::Raw;
+        if (value == "shell") return TemplateEscape::Shell;
+        if (value == "csv") return TemplateEscape::Csv;
+        return std::nullopt;
+    }
+
+    template <typename Source>
+    void OutputTemplate::execute(const Source& source, OutputBuffer& out) const {
+        std::string scratch;
+        for (const Op& op : ops_) {
+            if (op.literal) {
+                out.append(std::string_view(literals_).substr(op.offset, op.length));
+                continue;
+            }
+            const FieldValue value = field_value(source, op.field, scratch);
+            if (value.kind == FieldValue::Kind::Number) {
+                out.append_number(value.number);
+            } else if (value.kind == FieldValue::Kind::Text || escape_ == TemplateEscape::Shell) {
+                // Missing values still quote as '' so shell word splitting
+                // keeps every field in place.
+                append_escaped(value.text, escape_, out);
+            }
+        }
+        out.append('\n');
+    }
+
+    bool OutputTemplate::uses(TemplateField field) const {
+        return std::any_of(ops_.begin(), ops_.end(), [&](const Op& op) { return !op.literal && op.field == field; });
+    }
+
+    void OutputTemplate::render(const FileReport& report, OutputBuffer& out) const {
+        execute(report, out);
+    }
+
+    void OutputTemplate::render(const MatchedEntry& entry, OutputBuffer& out) const {
+        execute(entry, out);
+    }
+
+    std::shared_ptr<const OutputTemplate> compile_template(const std::string& text, TemplateEscape escape, std::string& error) {
+        std::string literals;
+        std::vector<OutputTemplate::Op> ops;
+
+        auto append_literal = [&](char c) {
+            if (ops.empty() || !ops.back().literal) {
+                ops.push_back({true, TemplateField::Path, literals.size(), 0});
+            }
+            literals.push_back(c);
+            ++ops.back().length;
+        };
+
+        for (std::size_t index = 0; index < text.size(); ++index) {
+            const char c = text[index];
+            const auto escaped = c == '\\' && index + 1 < text.size() ? unescape(text[index + 1]) : std::nullopt;
+            if (escaped) {
+                append_literal(*escaped);
+                ++index;
+            } else if ((c == '{' || c == '}') && index + 1 < text.size() && text[index + 1] == c) {
+                append_literal(c);
+                ++index;
+            } else if (c == '{') {
+                const auto close = text.find('}', index + 1);
+                if (close == std::string::npos) {
+                    error = "unterminated field at offset " + std::to_string(index);
+                    return nullptr;
+                }
+                const std::string_view name = std::string_view(text).substr(index + 1, close - index - 1);
+                const auto found = std::find_if(kFieldNames.begin(), kFieldNames.end(),
+                                                [&](const FieldName& entry) { return entry.name == name; });
+                if (found == kFieldNames.end()) {
+                    error = "unknown field {" + std::string(name) + "}";
+                    return nullptr;
+                }
+                ops.push_back({false, found->field, 0, 0});
+                index = close;
+            } else if (c == '}') {
+                error = "unmatched '}' at offset " + std::to_string(index) + " (use '}}' for a literal brace)";
+                return nullptr;
+            } else {
+                append_literal(c);
+            }
+        }
+
+        return std::make_shared<const OutputTemplate>(std::move(literals), std::move(ops), escape);
+    }
+}
@@ -0,0 +1,81 @@
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "file_probe/perf_counters.hpp"
+
+namespace file_probe {
+
+    namespace {
+        struct EventSpec {
+            const char* name;
+            std::uint32_t type;
+            std::uint64_t config;
+        };
+
+        constexpr std::array<EventSpec, kPerfEventCount> kEventSpecs = {{
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"cacheMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"branchMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"pageFaults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        }};
+
+        int open_event(const EventSpec& spec) {
+            perf_event_attr attr {};
+            attr.size = sizeof(attr);
+            attr.type = spec.type;
+            attr.config = spec.config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        }
+    }
+
+    const char* perf_event_name(PerfEvent event) {
+        return kEventSpecs[static_cast<std::size_t>(event)].name;
+    }
+
+    PerfCounters::PerfCounters() {
+        fds_.fill(-1);
+    }
+
+    PerfCounters::~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    std::optional<std::string> PerfCounters::open() {
+        std::string missing;
+        int first_error = 0;
+        for (std::size_t index = 0; index < kPerfEventCount; ++index) {
+            fds_[index] = open_event(kEventSpecs[index]);
+            if (fds_[index] < 0) {
+                first_error = first_error ? first_error : errno;
+                missing += (missing.empty() ? "" : ", ") + std::string(kEventSpecs[index].name);
+            }
+        }
+        if (missing.empty()) {
+            return std::nullopt;
+        }
+        return "Performance counters unavailable (" + missing + "): " + std::strerror(first_error);
+    }
+
+    bool PerfCounters::available(PerfEvent event) const {
+        return fds_[static_cast<std::size_t>(event)] >= 0;
+    }
+
+    PerfSample PerfCounters::read() const {
+        PerfSample sample {};
+        for (std::size_t index = 0; index < kPerfEventCount; ++index) {
+            if (fds_[index] >= 0 && ::read(fds_[index], &sample[index], sizeof(sample[index])) != sizeof(sample[index])) {
+                sample[index] = 0;
+            }
+        }
+        return sample;
+    }
+}
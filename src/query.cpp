@@ -0,0 +1,618 @@
+#include <grp.h>
+#include <pwd.h>
+#include <array>
+#include <ctime>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+#include <cstdint>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <algorithm>
+#include <string_view>
+#include "file_probe/hash.hpp"
+#include "file_probe/query.hpp"
+
+namespace file_probe {
+
+    namespace {
+        enum class TokenKind {
+            Identifier,
+            String,
+            Number,
+            Operator,
+            LeftParen,
+            RightParen,
+            End
+        };
+
+        struct Token {
+            TokenKind kind = TokenKind::End;
+            std::string text;
+            std::size_t position = 0;
+        };
+
+        enum class FieldKind {
+            String,
+            Number,
+            Time
+        };
+
+        // Relative evaluation cost; conjunctions and disjunctions run their
+        // cheapest operands first so expensive fields are reached last.
+        enum FieldCost {
+            kCostName = 0,
+            kCostStat = 1,
+            kCostClassify = 2,
+            kCostHash = 3
+        };
+
+        struct FieldDef {
+            std::string_view name;
+            FieldKind kind;
+            int cost;
+        };
+
+        constexpr std::array<FieldDef, 15> kFields = {{
+            {"name", FieldKind::String, kCostName},
+            {"path", FieldKind::String, kCostName},
+            {"ext", FieldKind::String, kCostName},
+            {"depth", FieldKind::Number, kCostName},
+            {"size", FieldKind::Number, kCostStat},
+            {"uid", FieldKind::Number, kCostStat},
+            {"gid", FieldKind::Number, kCostStat},
+            {"links", FieldKind::Number, kCostStat},
+            {"owner", FieldKind::String, kCostStat},
+            {"group", FieldKind::String, kCostStat},
+            {"mtime", FieldKind::Time, kCostStat},
+            {"atime", FieldKind::Time, kCostStat},
+            {"ctime", FieldKind::Time, kCostStat},
+            {"type", FieldKind::String, kCostClassify},
+            {"sha256", FieldKind::String, kCostHash},
+        }};
+
+        struct Node {
+            Query::Predicate eval;
+            int cost = 0;
+        };
+
+        std::string to_lowercase(std::string value) {
+            std::transform(value.begin(), value.end(), value.begin(),
+                        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return value;
+        }
+
+        std::vector<Token> tokenize(const std::string& text, std::string& error) {
+            std::vector<Token> tokens;
+            std::size_t index = 0;
+
+            while (index < text.size()) {
+                const char c = text[index];
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    ++index;
+                    continue;
+                }
+
+                Token token;
+                token.position = index;
+
+                if (c == '(' || c == ')') {
+                    token.kind = c == '(' ? TokenKind::LeftParen : TokenKind::RightParen;
+                    token.text = std::string(1, c);
+                    ++index;
+                } else if (c == '"' || c == '\'') {
+                    token.kind = TokenKind::String;
+                    ++index;
+                    while (index < text.size() && text[index] != c) {
+                        if (text[index] == '\\' && index + 1 < text.size()) {
+                            ++index;
+                        }
+                        token.text += text[index++];
+                    }
+                    if (index >= text.size()) {
+                        error = "unterminated string at position " + std::to_string(token.position);
+                        return {};
+                    }
+                    ++index;
+                } else if (std::isdigit(static_cast<unsigned char>(c))) {
+                    token.kind = TokenKind::Number;
+                    while (index < text.size() &&
+                        (std::isalnum(static_cast<unsigned char>(text[index])) || text[index] == '.')) {
+                        token.text += text[index++];
+                    }
+                } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                    token.kind = TokenKind::Identifier;
+                    while (index < text.size() &&
+                        (std::isalnum(static_cast<unsigned char>(text[index])) || text[index] == '_')) {
+                        token.text += text[index++];
+                    }
+                } else {
+                    static constexpr std::array<std::string_view, 12> kOperators = {
+                        "&&", "||", "==", "!=", "<=", ">=", "=~", "!~", "<", ">", "!", "+"};
+                    token.kind = TokenKind::Operator;
+                    for (std::string_view op : kOperators) {
+                        if (text.compare(index, op.size(), op) == 0) {
+                            token.text = std::string(op);
+                            break;
+                        }
+                    }
+                    if (token.text.empty() && c == '-') {
+                        token.text = "-";
+                    }
+                    if (token.text.empty()) {
+                        error = "unexpected character '" + std::string(1, c) + "' at position " + std::to_string(index);
+                        return {};
+                    }
+                    index += token.text.size();
+                }
+
+                tokens.push_back(std::move(token));
+            }
+
+            Token end;
+            end.position = text.size();
+            tokens.push_back(end);
+            return tokens;
+        }
+
+        std::optional<std::int64_t> parse_scaled(const std::string& text, bool time_units) {
+            std::size_t digits = 0;
+            while (digits < text.size() && (std::isdigit(static_cast<unsigned char>(text[digits])) || text[digits] == '.')) {
+                ++digits;
+            }
+            if (digits == 0) {
+                return std::nullopt;
+            }
+
+            char* end = nullptr;
+            const std::string number = text.substr(0, digits);
+            const double value = std::strtod(number.c_str(), &end);
+            if (end != number.c_str() + number.size()) {
+                return std::nullopt;
+            }
+
+            const std::string suffix = to_lowercase(text.substr(digits));
+            double scale = 1.0;
+            if (time_units) {
+                if (suffix.empty() || suffix == "s") scale = 1.0;
+                else if (suffix == "m") scale = 60.0;
+                else if (suffix == "h") scale = 3600.0;
+                else if (suffix == "d") scale = 86400.0;
+                else if (suffix == "w") scale = 7 * 86400.0;
+                else if (suffix == "y") scale = 365 * 86400.0;
+                else return std::nullopt;
+            } else {
+                static constexpr std::array<std::string_view, 5> kUnits = {"", "k", "m", "g", "t"};
+                std::string unit = suffix;
+                if (unit.size() > 1 && unit.back() == 'b') {
+                    unit.pop_back();
+                    if (unit.size() > 1 && unit.back() == 'i') {
+                        unit.pop_back();
+                    }
+                } else if (unit == "b") {
+                    unit.clear();
+                }
+                auto it = std::find(kUnits.begin(), kUnits.end(), unit);
+                if (it == kUnits.end()) {
+                    return std::nullopt;
+                }
+                for (auto step = kUnits.begin(); step != it; ++step) {
+                    scale *= 1024.0;
+                }
+            }
+
+            // 2^63 is exact as a double; anything at or above it does not fit.
+            const double scaled = value * scale;
+            if (!(scaled < 9223372036854775808.0)) {
+                return std::nullopt;
+            }
+            return static_cast<std::int64_t>(scaled);
+        }
+
+        std::optional<std::int64_t> parse_date(const std::string& text) {
+            std::tm parsed {};
+            const char* end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &parsed);
+            if (!end || *end != '\0') {
+                parsed = {};
+                end = strptime(text.c_str(), "%Y-%m-%d", &parsed);
+            }
+            if (!end || *end != '\0') {
+                return std::nullopt;
+            }
+            parsed.tm_isdst = -1;
+            const std::time_t value = std::mktime(&parsed);
+            if (value == static_cast<std::time_t>(-1)) {
+                return std::nullopt;
+            }
+            return static_cast<std::int64_t>(value);
+        }
+
+        template <typename Value>
+        bool compare(const Value& left, const std::string& op, const Value& right) {
+            if (op == "==") return left == right;
+            if (op == "!=") return left != right;
+            if (op == "<") return left < right;
+            if (op == "<=") return left <= right;
+            if (op == ">") return left > right;
+            return left >= right;
+        }
+
+        const std::string* string_field(EntryContext& entry, std::string_view field) {
+            if (field == "name") return &entry.name();
+            if (field == "path") return &entry.path().native();
+            if (field == "ext") return &entry.extension();
+            if (field == "type") return &entry.type();
+            if (field == "sha256") {
+                const auto& digest = entry.sha256();
+                return digest ? &*digest : nullptr;
+            }
+            if (!entry.info()) return nullptr;
+            if (field == "owner") return &entry.owner();
+            return &entry.group();
+        }
+
+        std::optional<std::int64_t> number_field(EntryContext& entry, std::string_view field) {
+            if (field == "depth") {
+                return static_cast<std::int64_t>(entry.depth());
+            }
+            const struct stat* info = entry.info();
+            if (!info) return std::nullopt;
+            if (field == "size") return static_cast<std::int64_t>(info->st_size);
+            if (field == "uid") return static_cast<std::int64_t>(info->st_uid);
+            if (field == "gid") return static_cast<std::int64_t>(info->st_gid);
+            if (field == "links") return static_cast<std::int64_t>(info->st_nlink);
+            if (field == "mtime") return static_cast<std::int64_t>(info->st_mtim.tv_sec);
+            if (field == "atime") return static_cast<std::int64_t>(info->st_atim.tv_sec);
+            return static_cast<std::int64_t>(info->st_ctim.tv_sec);
+        }
+
+        class Parser {
+        public:
+            Parser(std::vector<Token> tokens, std::string& error) : tokens_(std::move(tokens)), error_(error) {}
+
+            std::optional<Node> parse() {
+                auto node = parse_or();
+                if (node && peek().kind != TokenKind::End) {
+                    fail("unexpected '" + peek().text + "'");
+                    return std::nullopt;
+                }
+                return node;
+            }
+
+        private:
+            const Token& peek() const { return tokens_[index_]; }
+            const Token& next() { return tokens_[index_ < tokens_.size() - 1 ? index_++ : index_]; }
+
+            bool accept_operator(std::string_view op) {
+                if (peek().kind == TokenKind::Operator && peek().text == op) {
+                    ++index_;
+                    return true;
+                }
+                return false;
+            }
+
+            void fail(const std::string& message) {
+                if (error_.empty()) {
+                    error_ = message + " at position " + std::to_string(peek().position);
+                }
+            }
+
+            // Flattens a chain of the same boolean operator and orders operands
+            // by cost; predicates have no side effects, so reordering is safe.
+            std::optional<Node> parse_chain(std::string_view op, std::optional<Node> (Parser::*operand)()) {
+                std::vector<Node> operands;
+                auto first = (this->*operand)();
+                if (!first) {
+                    return std::nullopt;
+                }
+                operands.push_back(std::move(*first));
+                while (accept_operator(op)) {
+                    auto more = (this->*operand)();
+                    if (!more) {
+                        return std::nullopt;
+                    }
+                    operands.push_back(std::move(*more));
+                }
+                if (operands.size() == 1) {
+                    return std::move(operands.front());
+                }
+
+                std::stable_sort(operands.begin(), operands.end(), [](const Node& left, const Node& right) {
+                    return left.cost < right.cost;
+                });
+                Node node;
+                node.cost = operands.back().cost;
+                std::vector<Query::Predicate> predicates;
+                for (auto& item : operands) {
+                    predicates.push_back(std::move(item.eval));
+                }
+                const bool is_and = op == "&&";
+                node.eval = [predicates = std::move(predicates), is_and](EntryContext& entry) {
+                    for (const auto& predicate : predicates) {
+                        if (predicate(entry) != is_and) {
+                            return !is_and;
+                        }
+                    }
+                    return is_and;
+                };
+                return node;
+            }
+
+            std::optional<Node> parse_or() {
+                return parse_chain("||", &Parser::parse_and);
+            }
+
+            std::optional<Node> parse_and() {
+                return parse_chain("&&", &Parser::parse_unary);
+            }
+
+            std::optional<Node> parse_unary() {
+                if (accept_operator("!")) {
+                    auto inner = parse_unary();
+                    if (!inner) {
+                        return std::nullopt;
+                    }
+                    Node node;
+                    node.cost = inner->cost;
+                    node.eval = [eval = std::move(inner->eval)](EntryContext& entry) { return !eval(entry); };
+                    return node;
+                }
+                if (peek().kind == TokenKind::LeftParen) {
+                    next();
+                    auto inner = parse_or();
+                    if (!inner) {
+                        return std::nullopt;
+                    }
+                    if (peek().kind != TokenKind::RightParen) {
+                        fail("expected ')'");
+                        return std::nullopt;
+                    }
+                    next();
+                    return inner;
+                }
+                return parse_comparison();
+            }
+
+            std::optional<Node> parse_comparison() {
+                const Token field_token = next();
+                if (field_token.kind != TokenKind::Identifier) {
+                    fail("expected field name");
+                    return std::nullopt;
+                }
+                auto field = std::find_if(kFields.begin(), kFields.end(), [&](const FieldDef& def) {
+                    return def.name == field_token.text;
+                });
+                if (field == kFields.end()) {
+                    error_ = "unknown field '" + field_token.text + "'";
+                    return std::nullopt;
+                }
+
+                const Token op = next();
+                static constexpr std::array<std::string_view, 8> kComparisons = {
+                    "==", "!=", "<", "<=", ">", ">=", "=~", "!~"};
+                if (op.kind != TokenKind::Operator ||
+                    std::find(kComparisons.begin(), kComparisons.end(), op.text) == kComparisons.end()) {
+                    fail("expected comparison operator after '" + field_token.text + "'");
+                    return std::nullopt;
+                }
+
+                Node node;
+                node.cost = field->cost;
+                const std::string_view name = field->name;
+
+                if (field->kind == FieldKind::String) {
+                    const Token value = next();
+                    if (value.kind != TokenKind::String && value.kind != TokenKind::Identifier &&
+                        value.kind != TokenKind::Number) {
+                        fail("expected string value for '" + field_token.text + "'");
+                        return std::nullopt;
+                    }
+                    if (op.text == "=~" || op.text == "!~") {
+                        const bool negate = op.text == "!~";
+                        node.eval = [name, pattern = value.text, negate](EntryContext& entry) {
+                            const std::string* actual = string_field(entry, name);
+                            return actual && ((fnmatch(pattern.c_str(), actual->c_str(), 0) == 0) != negate);
+                        };
+                    } else if (op.text == "==" || op.text == "!=") {
+                        const bool negate = op.text == "!=";
+                        std::string expected = name == "ext" ? to_lowercase(value.text) : value.text;
+                        if (name == "ext" && !expected.empty() && expected.front() == '.') {
+                            expected.erase(0, 1);
+                        }
+                        node.eval = [name, expected = std::move(expected), negate](EntryContext& entry) {
+                            const std::string* actual = string_field(entry, name);
+                            return actual && ((*actual == expected) != negate);
+                        };
+                    } else {
+                        error_ = "operator " + op.text + " is not supported for '" + field_token.text + "'";
+                        return std::nullopt;
+                    }
+                    return node;
+                }
+
+                if (op.text == "=~" || op.text == "!~") {
+                    error_ = "operator " + op.text + " is only supported for text fields";
+                    return std::nullopt;
+                }
+
+                auto expected = field->kind == FieldKind::Time ? parse_time_value() : parse_number_value();
+                if (!expected) {
+                    return std::nullopt;
+                }
+                node.eval = [name, comparison = op.text, expected = *expected](EntryContext& entry) {
+                    auto actual = number_field(entry, name);
+                    return actual && compare(*actual, comparison, expected);
+                };
+                return node;
+            }
+
+            std::optional<std::int64_t> parse_number_value() {
+                const Token value = next();
+                auto parsed = value.kind == TokenKind::Number ? parse_scaled(value.text, false) : std::nullopt;
+                if (!parsed) {
+                    fail("invalid number '" + value.text + "'");
+                }
+                return parsed;
+            }
+
+            // Accepts now, now-30d, now+1h, "YYYY-MM-DD[ HH:MM:SS]" or epoch seconds.
+            std::optional<std::int64_t> parse_time_value() {
+                const Token value = next();
+                if (value.kind == TokenKind::Identifier && value.text == "now") {
+                    const auto now = static_cast<std::int64_t>(std::time(nullptr));
+                    const bool minus = accept_operator("-");
+                    if (!minus && !accept_operator("+")) {
+                        return now;
+                    }
+                    const Token amount = next();
+                    auto offset = amount.kind == TokenKind::Number ? parse_scaled(amount.text, true) : std::nullopt;
+                    if (!offset) {
+                        fail("invalid duration '" + amount.text + "'");
+                        return std::nullopt;
+                    }
+                    return minus ? now - *offset : now + *offset;
+                }
+                if (value.kind == TokenKind::String) {
+                    auto parsed = parse_date(value.text);
+                    if (!parsed) {
+                        fail("invalid date '" + value.text + "'");
+                    }
+                    return parsed;
+                }
+                if (value.kind == TokenKind::Number) {
+                    auto parsed = parse_scaled(value.text, true);
+                    if (!parsed) {
+                        fail("invalid time '" + value.text + "'");
+                    }
+                    return parsed;
+                }
+                fail("expected time value");
+                return std::nullopt;
+            }
+
+            std::vector<Token> tokens_;
+            std::size_t index_ = 0;
+            std::string& error_;
+        };
+    }
+
+    EntryContext::EntryContext(std::filesystem::path path, std::size_t depth, Classifier classifier, Loader loader,
+                               Hasher hasher)
+        : path_(std::move(path)), depth_(depth), classifier_(std::move(classifier)), loader_(std::move(loader)),
+          hasher_(std::move(hasher)) {}
+
+    const std::string& EntryContext::name() {
+        if (!name_) {
+            name_ = path_.filename().string();
+        }
+        return *name_;
+    }
+
+    const std::string& EntryContext::extension() {
+        if (!extension_) {
+            std::string ext = to_lowercase(path_.extension().string());
+            if (!ext.empty() && ext.front() == '.') {
+                ext.erase(0, 1);
+            }
+            extension_ = std::move(ext);
+        }
+        return *extension_;
+    }
+
+    const struct stat* EntryContext::info() {
+        if (!has_info_) {
+            has_info_ = lstat(path_.c_str(), &info_) == 0;
+        }
+        return *has_info_ ? &info_ : nullptr;
+    }
+
+    void EntryContext::set_info(const struct stat& info) {
+        info_ = info;
+        has_info_ = true;
+    }
+
+    const SmallFile* EntryContext::contents() {
+        if (!contents_done_) {
+            contents_done_ = true;
+            const struct stat* stat_info = info();
+            if (!stat_info || !S_ISREG(stat_info->st_mode)) {
+                return nullptr;
+            }
+            if (loader_) {
+                contents_ = loader_();
+            } else if ((owned_contents_ = read_small_file(AT_FDCWD, path_.c_str()))) {
+                contents_ = &*owned_contents_;
+            }
+        }
+        return contents_;
+    }
+
+    const std::string& EntryContext::type() {
+        if (!type_) {
+            const struct stat* stat_info = info();
+            if (!stat_info) {
+                type_ = "Unknown";
+            } else if (S_ISLNK(stat_info->st_mode)) {
+                type_ = "Symlink";
+            } else if (S_ISDIR(stat_info->st_mode)) {
+                type_ = "Directory";
+            } else if (S_ISREG(stat_info->st_mode)) {
+                type_ = classifier_ ? classifier_(*this) : "Binary";
+            } else {
+                type_ = "Special";
+            }
+        }
+        return *type_;
+    }
+
+    const std::string& EntryContext::owner() {
+        if (!owner_) {
+            const struct stat* stat_info = info();
+            const uid_t uid = stat_info ? stat_info->st_uid : 0;
+            struct passwd* pwd = stat_info ? getpwuid(uid) : nullptr;
+            owner_ = pwd && pwd->pw_name ? std::string(pwd->pw_name) : std::to_string(uid);
+        }
+        return *owner_;
+    }
+
+    const std::string& EntryContext::group() {
+        if (!group_) {
+            const struct stat* stat_info = info();
+            const gid_t gid = stat_info ? stat_info->st_gid : 0;
+            struct group* grp = stat_info ? getgrgid(gid) : nullptr;
+            group_ = grp && grp->gr_name ? std::string(grp->gr_name) : std::to_string(gid);
+        }
+        return *group_;
+    }
+
+    const std::optional<std::string>& EntryContext::sha256() {
+        if (!sha256_done_) {
+            sha256_done_ = true;
+            if (const SmallFile* file = contents()) {
+                if (file->loaded) {
+                    sha256_ = sha256_hex(file->data(), file->size);
+                } else {
+                    sha256_ = hasher_ ? hasher_(*file) : compute_sha256(file->fd.get());
+                }
+            }
+        }
+        return sha256_;
+    }
+
+    std::shared_ptr<const Query> compile_query(const std::string& text, std::string& error) {
+        error.clear();
+        auto tokens = tokenize(text, error);
+        if (!error.empty()) {
+            return nullptr;
+        }
+        Parser parser(std::move(tokens), error);
+        auto node = parser.parse();
+        if (!node) {
+            if (error.empty()) {
+                error = "invalid expression";
+            }
+            return nullptr;
+        }
+        return std::make_shared<const Query>(std::move(node->eval));
+    }
+}
@@ -1,9 +1,17 @@
+#include <array>
+#include <algorithm>
 #include <vector>
+#include <iomanip>
 #include <sstream>
 #include <iostream>
 #include <optional>
+#include <unistd.h>
 #include "file_probe/utils.hpp"
 #include "file_probe/render.hpp"
+#include "file_probe/alloc_stats.hpp"
+#include "file_probe/output_template.hpp"
+#include "file_probe/table.hpp"
+#include "file_probe/grouping.hpp"
 
 namespace file_probe {
 
@@ -13,6 +21,11 @@ namespace file_probe {
         constexpr const char* kColorValue = "\033[1;32m";
         constexpr const char* kColorError = "\033[1;31m";
 
+        constexpr std::array<std::pair<const char*, double>, 3> kSketchQuantiles {{
+            {"p50", 0.50}, {"p90", 0.90}, {"p99", 0.99}
+        }};
+        constexpr std::size_t kTopExtensions = 5;
+
         class JsonBuilder {
         public:
             void add_string(const std::string& key, const std::string& value) {
@@ -40,6 +53,11 @@ namespace file_probe {
                 }
             }
 
+            void add_raw(const std::string& key, const std::string& raw_json) {
+                add_separator();
+                stream_ << "\"" << key << "\":" << raw_json;
+            }
+
             void add_array(const std::string& key, const std::vector<std::string>& values) {
                 if (values.empty()) {
                     return;
@@ -72,6 +90,23 @@ namespace file_probe {
             std::ostringstream stream_;
         };
 
+        const char* table_color(const std::string& type) {
+            if (type == "Directory") return kColorKey;
+            if (type == "Symlink") return "\033[1;36m";
+            return nullptr;
+        }
+
+        double to_milliseconds(std::chrono::nanoseconds elapsed) {
+            return std::chrono::duration<double, std::milli>(elapsed).count();
+        }
+
+        double throughput_mib(const ReadProfile& profile) {
+            if (profile.seconds <= 0.0) {
+                return 0.0;
+            }
+            return static_cast<double>(profile.bytes_read) / (1024.0 * 1024.0) / profile.seconds;
+        }
+
         void render_symlink_text(const FileReport& report) {
             std::cout << kColorKey << "Symlink: " << kColorValue
                     << (report.symlink.is_symlink ? "Yes" : "No") << kColorReset << "\n";
@@ -88,9 +123,186 @@ namespace file_probe {
             }
         }
 
+        std::string join(const std::vector<std::string>& values) {
+            std::string text;
+            for (const auto& value : values) {
+                if (!text.empty()) {
+                    text += ", ";
+                }
+                text += value;
+            }
+            return text;
+        }
+
+        bool has_counts(const PerfSample& sample) {
+            for (std::uint64_t value : sample) {
+                if (value != 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::string format_count(std::uint64_t value) {
+            const char* suffixes[] = {"", "K", "M", "G", "T"};
+            double scaled = static_cast<double>(value);
+            std::size_t suffix = 0;
+            while (scaled >= 1000.0 && suffix < 4) {
+                scaled /= 1000.0;
+                ++suffix;
+            }
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(suffix == 0 ? 0 : 2) << scaled << suffixes[suffix];
+            return stream.str();
+        }
+
+        std::string describe_counters(const PerfCounters& counters, const PerfSample& sample) {
+            auto value = [&](PerfEvent event) { return sample[static_cast<std::size_t>(event)]; };
+            std::vector<std::string> parts;
+            if (counters.available(PerfEvent::Cycles)) {
+                parts.push_back(format_count(value(PerfEvent::Cycles)) + " cycles");
+            }
+            if (counters.available(PerfEvent::Instructions)) {
+                std::string text = format_count(value(PerfEvent::Instructions)) + " instructions";
+                if (counters.available(PerfEvent::Cycles) && value(PerfEvent::Cycles) > 0) {
+                    std::ostringstream ipc;
+                    ipc << std::fixed << std::setprecision(2)
+                        << static_cast<double>(value(PerfEvent::Instructions)) / static_cast<double>(value(PerfEvent::Cycles));
+                    text += " (IPC " + ipc.str() + ")";
+                }
+                parts.push_back(text);
+            }
+            if (counters.available(PerfEvent::CacheMisses)) {
+                parts.push_back(format_count(value(PerfEvent::CacheMisses)) + " cache misses");
+            }
+            if (counters.available(PerfEvent::BranchMisses)) {
+                parts.push_back(format_count(value(PerfEvent::BranchMisses)) + " branch misses");
+            }
+            if (counters.available(PerfEvent::PageFaults)) {
+                parts.push_back(format_count(value(PerfEvent::PageFaults)) + " page faults");
+            }
+            return join(parts);
+        }
+
+        void render_security_text(const SecurityInfo& security) {
+            std::vector<std::string> special;
+            if (security.setuid) special.emplace_back("setuid");
+            if (security.setgid) special.emplace_back("setgid");
+            if (security.sticky) special.emplace_back("sticky");
+
+            std::cout << kColorKey << "Special Bits: " << kColorValue
+                    << (special.empty() ? "None" : join(special)) << kColorReset << "\n";
+            std::cout << kColorKey << "Extended Attributes: " << kColorValue
+                    << (security.xattrs.empty() ? "None" : join(security.xattrs)) << kColorReset << "\n";
+            if (security.acl) {
+                std::cout << kColorKey << "ACL: " << kColorValue << *security.acl << kColorReset << "\n";
+            }
+            if (security.default_acl) {
+                std::cout << kColorKey << "Default ACL: " << kColorValue << *security.default_acl << kColorReset << "\n";
+            }
+            if (security.capabilities) {
+                std::cout << kColorKey << "Capabilities: " << kColorValue << *security.capabilities << kColorReset << "\n";
+            }
+            std::cout << kColorKey << "File Flags: " << kColorValue
+                    << (security.flags.empty() ? "None" : join(security.flags)) << kColorReset << "\n";
+        }
+
+        void render_security_summary_text(const SecuritySummary& summary) {
+            std::cout << kColorKey << "Setuid Entries: " << kColorValue << summary.setuid_count << kColorReset << "\n";
+            std::cout << kColorKey << "Setgid Entries: " << kColorValue << summary.setgid_count << kColorReset << "\n";
+            std::cout << kColorKey << "Sticky Entries: " << kColorValue << summary.sticky_count << kColorReset << "\n";
+            std::cout << kColorKey << "Entries With Capabilities: " << kColorValue << summary.capability_count << kColorReset << "\n";
+            std::cout << kColorKey << "Entries With ACLs: " << kColorValue << summary.acl_count << kColorReset << "\n";
+            std::cout << kColorKey << "Immutable Entries: " << kColorValue << summary.immutable_count << kColorReset << "\n";
+            std::cout << kColorKey << "Append-only Entries: " << kColorValue << summary.append_only_count << kColorReset << "\n";
+        }
+
+        void render_extents_text(const ExtentInfo& extents) {
+            std::cout << kColorKey << "Extents: " << kColorValue << extents.extent_count << kColorReset << "\n";
+            std::cout << kColorKey << "Fragments: " << kColorValue << extents.fragment_count
+                    << " (expected " << extents.expected_fragments << ")"
+                    << (extents.fragmented ? ", fragmented" : "") << kColorReset << "\n";
+            std::cout << kColorKey << "Shared Extents: " << kColorValue << extents.shared_extents
+                    << " (" << format_size(extents.shared_bytes) << ")" << kColorReset << "\n";
+            if (extents.unwritten_extents > 0) {
+                std::cout << kColorKey << "Unwritten Extents: " << kColorValue << extents.unwritten_extents << kColorReset << "\n";
+            }
+            if (extents.inline_extents > 0) {
+                std::cout << kColorKey << "Inline Extents: " << kColorValue << extents.inline_extents << kColorReset << "\n";
+            }
+        }
+
+        void render_extent_summary_text(const ExtentSummary& summary) {
+            std::cout << kColorKey << "Mapped Files: " << kColorValue << summary.files_mapped;
+            if (summary.files_unmapped > 0) {
+                std::cout << " (" << summary.files_unmapped << " unmapped)";
+            }
+            std::cout << kColorReset << "\n";
+            std::cout << kColorKey << "Total Extents: " << kColorValue << summary.total_extents << kColorReset << "\n";
+            std::cout << kColorKey << "Fragmented Files: " << kColorValue << summary.fragmented_files << kColorReset << "\n";
+            std::cout << kColorKey << "Files With Shared Extents: " << kColorValue << summary.files_with_shared_extents
+                    << " (" << format_size(summary.shared_bytes) << ")" << kColorReset << "\n";
+            if (summary.most_fragmented_path) {
+                std::cout << kColorKey << "Most Fragmented: " << kColorValue << *summary.most_fragmented_path
+                        << " (" << summary.most_fragmented_count << " fragments)" << kColorReset << "\n";
+            }
+        }
+
+        void render_symlink_summary_text(const SymlinkSummary& summary) {
+            std::cout << kColorKey << "Symlinks: " << kColorValue << summary.symlink_count << kColorReset << "\n";
+            std::cout << kColorKey << "Broken Symlinks: " << kColorValue << summary.broken_count << kColorReset << "\n";
+            if (summary.followed_count > 0 || summary.loop_count > 0) {
+                std::cout << kColorKey << "Followed Symlinks: " << kColorValue << summary.followed_count
+                        << " (" << summary.loop_count << " loops skipped)" << kColorReset << "\n";
+            }
+            for (const auto& dangling : summary.dangling) {
+                std::cout << kColorKey << "  Dangling: " << kColorValue << dangling << kColorReset << "\n";
+            }
+        }
+
+        void render_physical_usage_text(const PhysicalUsage& usage) {
+            std::cout << kColorKey << "Physical Usage: " << kColorValue << format_size(usage.physical_bytes) << kColorReset << "\n";
+            std::cout << kColorKey << "Exclusive Bytes: " << kColorValue << format_size(usage.exclusive_bytes) << kColorReset << "\n";
+            std::cout << kColorKey << "Shared Bytes: " << kColorValue << format_size(usage.shared_bytes) << kColorReset << "\n";
+            std::cout << kColorKey << "Saved By Sharing: " << kColorValue
+                    << format_size(usage.referenced_bytes - usage.physical_bytes) << kColorReset << "\n";
+        }
+
+        std::string format_days(double days) {
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(1) << days;
+            return stream.str();
+        }
+
+        void render_sketches_text(const SketchSet& sketches) {
+            std::cout << kColorKey << "Distinct Content (est.): " << kColorValue << sketches.distinct_content.estimate()
+                    << " of " << sketches.hashed_files << " hashed files" << kColorReset << "\n";
+            std::cout << kColorKey << "Size Percentiles: " << kColorValue;
+            for (std::size_t i = 0; i < kSketchQuantiles.size(); ++i) {
+                std::cout << (i > 0 ? ", " : "") << kSketchQuantiles[i].first << " "
+                        << format_size(static_cast<uintmax_t>(sketches.size_bytes.quantile(kSketchQuantiles[i].second)));
+            }
+            std::cout << kColorReset << "\n";
+            std::cout << kColorKey << "Age Percentiles: " << kColorValue;
+            for (std::size_t i = 0; i < kSketchQuantiles.size(); ++i) {
+                std::cout << (i > 0 ? ", " : "") << kSketchQuantiles[i].first << " "
+                        << format_days(sketches.age_days.quantile(kSketchQuantiles[i].second)) << "d";
+            }
+            std::cout << kColorReset << "\n";
+            std::vector<std::string> extensions;
+            for (const auto& [extension, count] : sketches.extensions.top(kTopExtensions)) {
+                extensions.push_back(extension + " (~" + std::to_string(count) + ")");
+            }
+            std::cout << kColorKey << "Top Extensions (est.): " << kColorValue << join(extensions) << kColorReset << "\n";
+        }
+
         void render_file_detail_text(const FileDetail& detail) {
             std::cout << kColorKey << "Size: " << kColorValue << detail.size_human << kColorReset << "\n";
             std::cout << kColorKey << "Checksum (SHA-256): " << kColorValue << detail.checksum << kColorReset << "\n";
+            if (detail.hashset_match) {
+                std::cout << kColorKey << "Hash Set Match: " << kColorValue << (*detail.hashset_match ? "Yes" : "No")
+                        << kColorReset << "\n";
+            }
             if (detail.resolution) {
                 std::cout << kColorKey << "Resolution: " << kColorValue << *detail.resolution << kColorReset << "\n";
             }
@@ -100,12 +312,72 @@ namespace file_probe {
             if (detail.duration) {
                 std::cout << kColorKey << "Duration: " << kColorValue << *detail.duration << kColorReset << "\n";
             }
+            if (detail.extents) {
+                render_extents_text(*detail.extents);
+            }
         }
 
         void render_directory_detail_text(const DirectoryDetail& detail) {
             std::cout << kColorKey << "Total Size: " << kColorValue << detail.total_size_human << kColorReset << "\n";
             std::cout << kColorKey << "File Count: " << kColorValue << detail.file_count << kColorReset << "\n";
             std::cout << kColorKey << "Directory Count: " << kColorValue << detail.directory_count << kColorReset << "\n";
+            if (detail.symlinks.symlink_count > 0) {
+                render_symlink_summary_text(detail.symlinks);
+            }
+            if (detail.security) {
+                render_security_summary_text(*detail.security);
+            }
+            if (detail.extents) {
+                render_extent_summary_text(*detail.extents);
+            }
+            if (detail.physical_usage) {
+                render_physical_usage_text(*detail.physical_usage);
+            }
+            if (detail.groups) {
+                std::cout << kColorKey << "Grouped By: " << kColorValue << group_key_name(detail.groups->key) << kColorReset << "\n";
+                for (const auto& row : detail.groups->rows) {
+                    std::cout << kColorKey << "  " << row.key << ": " << kColorValue
+                            << row.count << " files, " << format_size(row.total_size_bytes)
+                            << " (max " << format_size(row.max_size_bytes)
+                            << ", newest " << format_time(row.newest_mtime) << ")" << kColorReset << "\n";
+                }
+            }
+            if (detail.sketches) {
+                render_sketches_text(*detail.sketches);
+            }
+            if (detail.tree_hash) {
+                std::cout << kColorKey << "Tree Hash: " << kColorValue << detail.tree_hash->digest << kColorReset << "\n";
+                for (const auto& [name, digest] : detail.tree_hash->children) {
+                    std::cout << kColorKey << "  " << name << "/: " << kColorValue << digest << kColorReset << "\n";
+                }
+                if (detail.tree_hash->unreadable_entries > 0) {
+                    std::cout << kColorKey << "Tree Hash Unreadable Entries: " << kColorValue
+                            << detail.tree_hash->unreadable_entries << kColorReset << "\n";
+                }
+            }
+            if (detail.hashset) {
+                std::cout << kColorKey << "Hash Set Matches: " << kColorValue << detail.hashset->matched_files
+                        << " of " << detail.hashset->checked_files << " files" << kColorReset << "\n";
+                for (const auto& matched : detail.hashset->matched) {
+                    std::cout << kColorKey << "  " << kColorValue << matched << kColorReset << "\n";
+                }
+            }
+            if (detail.matches) {
+                const std::size_t listed = std::min(detail.matches->size(), kMaxMatchesReported);
+                std::cout << kColorKey << "Matches: " << kColorValue << detail.match_count;
+                if (listed < detail.match_count) {
+                    std::cout << " (first " << listed << " listed)";
+                }
+                std::cout << kColorReset << "\n";
+                for (std::size_t i = 0; i < listed; ++i) {
+                    const MatchedEntry& match = (*detail.matches)[i];
+                    std::cout << kColorKey << "  " << match.type << ": " << kColorValue << match.path;
+                    if (match.type != "Directory") {
+                        std::cout << " (" << format_size(match.size_bytes) << ")";
+                    }
+                    std::cout << kColorReset << "\n";
+                }
+            }
         }
     }
 
@@ -134,6 +406,10 @@ namespace file_probe {
             std::cout << kColorKey << "Last Change Time: " << kColorValue << report.timestamps->last_change << kColorReset << "\n";
         }
 
+        if (report.security) {
+            render_security_text(*report.security);
+        }
+
         if (report.file_detail) {
             render_file_detail_text(*report.file_detail);
         } else if (report.directory_detail) {
@@ -145,6 +421,64 @@ namespace file_probe {
         }
     }
 
+    void render_template(const FileReport& report, const OutputTemplate& output_template) {
+        {
+            OutputBuffer out(STDOUT_FILENO);
+            const auto& directory = report.directory_detail;
+            if (directory && directory->matches) {
+                for (const auto& entry : *directory->matches) {
+                    output_template.render(entry, out);
+                }
+            } else {
+                output_template.render(report, out);
+            }
+        }
+
+        for (const auto& warning : report.warnings) {
+            std::cerr << kColorError << "Warning: " << warning << kColorReset << "\n";
+        }
+    }
+
+    void render_table(const FileReport& report, bool fixed_widths) {
+        {
+            OutputBuffer out(STDOUT_FILENO);
+            const bool color = ::isatty(STDOUT_FILENO) == 1;
+            const auto& directory = report.directory_detail;
+            if (directory && directory->matches) {
+                TableWriter table(out, {{10, false}, {12, true}, {0, false}}, fixed_widths);
+                for (const auto& entry : *directory->matches) {
+                    table.add_row({entry.type, std::to_string(entry.size_bytes), entry.path},
+                                  color ? table_color(entry.type) : nullptr);
+                }
+            } else {
+                std::string size = "-";
+                if (report.file_detail) {
+                    size = std::to_string(report.file_detail->size_bytes);
+                } else if (directory) {
+                    size = std::to_string(directory->total_size_bytes);
+                }
+                std::string path = report.absolute_path.string();
+                if (report.symlink.is_symlink && report.symlink.target) {
+                    path += " -> " + *report.symlink.target;
+                }
+                TableWriter table(out, {{10, false}, {8, false}, {8, false}, {12, true}, {19, false}, {10, false}, {0, false}},
+                                  fixed_widths);
+                table.add_row({report.permissions.value_or("-"),
+                               report.ownership ? report.ownership->owner : "-",
+                               report.ownership ? report.ownership->group : "-",
+                               size,
+                               report.timestamps ? report.timestamps->last_modify : "-",
+                               report.type,
+                               path},
+                              color ? table_color(report.type) : nullptr);
+            }
+        }
+
+        for (const auto& warning : report.warnings) {
+            std::cerr << kColorError << "Warning: " << warning << kColorReset << "\n";
+        }
+    }
+
     void render_json(const FileReport& report) {
         if (!report.target_exists && !report.symlink.is_symlink) {
             std::ostringstream err;
@@ -187,13 +521,37 @@ namespace file_probe {
             json.add_string("lastChange", report.timestamps->last_change);
         }
 
+        if (report.security) {
+            json.add_bool("setuid", report.security->setuid);
+            json.add_bool("setgid", report.security->setgid);
+            json.add_bool("sticky", report.security->sticky);
+            json.add_array("xattrs", report.security->xattrs);
+            json.add_optional_string("acl", report.security->acl);
+            json.add_optional_string("defaultAcl", report.security->default_acl);
+            json.add_optional_string("capabilities", report.security->capabilities);
+            json.add_array("fileFlags", report.security->flags);
+        }
+
         if (report.file_detail) {
             json.add_number("sizeBytes", report.file_detail->size_bytes);
             json.add_string("size", report.file_detail->size_human);
             json.add_string("checksumSha256", report.file_detail->checksum);
+            if (report.file_detail->hashset_match) {
+                json.add_bool("hashsetMatch", *report.file_detail->hashset_match);
+            }
             json.add_optional_string("resolution", report.file_detail->resolution);
             json.add_optional_string("metadata", report.file_detail->metadata);
             json.add_optional_string("duration", report.file_detail->duration);
+            if (const auto& extents = report.file_detail->extents) {
+                json.add_number("extentCount", extents->extent_count);
+                json.add_number("fragmentCount", extents->fragment_count);
+                json.add_number("expectedFragments", extents->expected_fragments);
+                json.add_bool("fragmented", extents->fragmented);
+                json.add_number("sharedExtents", extents->shared_extents);
+                json.add_number("sharedBytes", extents->shared_bytes);
+                json.add_number("unwrittenExtents", extents->unwritten_extents);
+                json.add_number("inlineExtents", extents->inline_extents);
+            }
         }
 
         if (report.directory_detail) {
@@ -201,10 +559,225 @@ namespace file_probe {
             json.add_string("totalSize", report.directory_detail->total_size_human);
             json.add_number("fileCount", report.directory_detail->file_count);
             json.add_number("directoryCount", report.directory_detail->directory_count);
+            const SymlinkSummary& symlinks = report.directory_detail->symlinks;
+            json.add_number("symlinkCount", symlinks.symlink_count);
+            json.add_number("brokenSymlinkCount", symlinks.broken_count);
+            json.add_number("followedSymlinkCount", symlinks.followed_count);
+            json.add_number("symlinkLoopCount", symlinks.loop_count);
+            json.add_array("danglingSymlinks", symlinks.dangling);
+            if (const auto& security = report.directory_detail->security) {
+                json.add_number("setuidCount", security->setuid_count);
+                json.add_number("setgidCount", security->setgid_count);
+                json.add_number("stickyCount", security->sticky_count);
+                json.add_number("capabilityCount", security->capability_count);
+                json.add_number("aclCount", security->acl_count);
+                json.add_number("immutableCount", security->immutable_count);
+                json.add_number("appendOnlyCount", security->append_only_count);
+            }
+            if (const auto& extents = report.directory_detail->extents) {
+                json.add_number("mappedFiles", extents->files_mapped);
+                json.add_number("unmappedFiles", extents->files_unmapped);
+                json.add_number("totalExtents", extents->total_extents);
+                json.add_number("fragmentedFiles", extents->fragmented_files);
+                json.add_number("filesWithSharedExtents", extents->files_with_shared_extents);
+                json.add_number("sharedBytes", extents->shared_bytes);
+                json.add_optional_string("mostFragmented", extents->most_fragmented_path);
+                json.add_number("mostFragmentedCount", extents->most_fragmented_count);
+            }
+            if (const auto& usage = report.directory_detail->physical_usage) {
+                json.add_number("referencedBytes", usage->referenced_bytes);
+                json.add_number("physicalBytes", usage->physical_bytes);
+                json.add_number("exclusiveBytes", usage->exclusive_bytes);
+                json.add_number("sharedPhysicalBytes", usage->shared_bytes);
+                json.add_number("unmappedBytes", usage->unmapped_bytes);
+                json.add_number("physicalExtents", usage->extent_count);
+            }
+            if (const auto& groups = report.directory_detail->groups) {
+                std::string rows = "[";
+                for (std::size_t i = 0; i < groups->rows.size(); ++i) {
+                    const GroupRow& row = groups->rows[i];
+                    JsonBuilder entry;
+                    entry.add_string("key", row.key);
+                    entry.add_number("count", row.count);
+                    entry.add_number("totalSizeBytes", row.total_size_bytes);
+                    entry.add_number("maxSizeBytes", row.max_size_bytes);
+                    entry.add_string("newestModify", format_time(row.newest_mtime));
+                    rows += (i > 0 ? ",{" : "{") + entry.str() + "}";
+                }
+                json.add_string("groupBy", group_key_name(groups->key));
+                json.add_raw("groups", rows + "]");
+            }
+            if (const auto& sketches = report.directory_detail->sketches) {
+                JsonBuilder sizes;
+                JsonBuilder ages;
+                for (const auto& [label, rank] : kSketchQuantiles) {
+                    sizes.add_number(label, static_cast<uintmax_t>(sketches->size_bytes.quantile(rank)));
+                    ages.add_raw(label, format_days(sketches->age_days.quantile(rank)));
+                }
+                std::string extensions = "[";
+                const auto top = sketches->extensions.top(kTopExtensions);
+                for (std::size_t i = 0; i < top.size(); ++i) {
+                    JsonBuilder entry;
+                    entry.add_string("extension", top[i].first);
+                    entry.add_number("count", top[i].second);
+                    extensions += (i > 0 ? ",{" : "{") + entry.str() + "}";
+                }
+                JsonBuilder estimates;
+                estimates.add_number("hashedFiles", sketches->hashed_files);
+                estimates.add_number("distinctContent", sketches->distinct_content.estimate());
+                estimates.add_raw("sizeBytes", "{" + sizes.str() + "}");
+                estimates.add_raw("ageDays", "{" + ages.str() + "}");
+                estimates.add_raw("topExtensions", extensions + "]");
+                json.add_raw("sketches", "{" + estimates.str() + "}");
+            }
+            if (const auto& tree = report.directory_detail->tree_hash) {
+                JsonBuilder children;
+                for (const auto& [name, digest] : tree->children) {
+                    children.add_string(json_escape(name), digest);
+                }
+                JsonBuilder summary;
+                summary.add_string("digest", tree->digest);
+                summary.add_raw("children", "{" + children.str() + "}");
+                summary.add_number("unreadableEntries", tree->unreadable_entries);
+                json.add_raw("treeHash", "{" + summary.str() + "}");
+            }
+            if (const auto& hashset = report.directory_detail->hashset) {
+                JsonBuilder summary;
+                summary.add_number("checkedFiles", hashset->checked_files);
+                summary.add_number("matchedFiles", hashset->matched_files);
+                summary.add_array("matched", hashset->matched);
+                json.add_raw("hashset", "{" + summary.str() + "}");
+            }
+            if (const auto& matches = report.directory_detail->matches) {
+                std::string entries = "[";
+                for (std::size_t i = 0; i < std::min(matches->size(), kMaxMatchesReported); ++i) {
+                    JsonBuilder entry;
+                    entry.add_string("path", (*matches)[i].path);
+                    entry.add_string("type", (*matches)[i].type);
+                    entry.add_number("sizeBytes", (*matches)[i].size_bytes);
+                    entries += (i > 0 ? ",{" : "{") + entry.str() + "}";
+                }
+                json.add_raw("matches", entries + "]");
+                json.add_number("matchCount", report.directory_detail->match_count);
+            }
         }
 
         json.add_array("warnings", report.warnings);
 
         std::cout << '{' << json.str() << "}\n";
     }
+
+    void render_timings_text(const PhaseRecorder& recorder) {
+        for (std::size_t index = 0; index < kPhaseCount; ++index) {
+            const Phase phase = static_cast<Phase>(index);
+            std::cerr << kColorKey << "Timing (" << phase_name(phase) << "): " << kColorValue
+                    << std::fixed << std::setprecision(3) << to_milliseconds(recorder.elapsed(phase)) << " ms"
+                    << kColorReset << "\n";
+        }
+
+        if (const PerfCounters* counters = recorder.perf_counters()) {
+            for (std::size_t index = 0; index < kPhaseCount; ++index) {
+                const Phase phase = static_cast<Phase>(index);
+                if (!has_counts(recorder.counters(phase))) {
+                    continue;
+                }
+                std::cerr << kColorKey << "Counters (" << phase_name(phase) << "): " << kColorValue
+                        << describe_counters(*counters, recorder.counters(phase)) << kColorReset << "\n";
+            }
+        }
+
+        if (allocation_tracking_enabled()) {
+            for (std::size_t index = 0; index <= kPhaseCount; ++index) {
+                const std::optional<Phase> phase = index < kPhaseCount ? std::optional<Phase>(static_cast<Phase>(index)) : std::nullopt;
+                const AllocationStats stats = thread_allocation_stats(phase);
+                if (stats.allocations == 0 && stats.frees == 0) {
+                    continue;
+                }
+                std::cerr << kColorKey << "Allocations (" << (phase ? phase_name(*phase) : "unscoped") << "): "
+                        << kColorValue << stats.allocations << " allocs, " << stats.frees << " frees, "
+                        << format_size(stats.bytes) << kColorReset << "\n";
+            }
+        }
+
+        if (const auto& profile = recorder.read_profile()) {
+            std::cerr << kColorKey << "Read Strategy: " << kColorValue << profile->filesystem
+                    << ", block " << format_size(profile->block_size)
+                    << ", chunk " << format_size(profile->initial_chunk) << " -> " << format_size(profile->final_chunk)
+                    << ", readahead " << format_size(profile->readahead)
+                    << ", " << std::fixed << std::setprecision(1) << throughput_mib(*profile) << " MiB/s"
+                    << kColorReset << "\n";
+        }
+    }
+
+    void render_timings_json(const PhaseRecorder& recorder) {
+        std::ostringstream phases;
+        phases << std::fixed << std::setprecision(3);
+        for (std::size_t index = 0; index < kPhaseCount; ++index) {
+            const Phase phase = static_cast<Phase>(index);
+            if (index > 0) {
+                phases << ",";
+            }
+            phases << "\"" << phase_name(phase) << "Ms\":" << to_milliseconds(recorder.elapsed(phase));
+        }
+
+        JsonBuilder json;
+        if (const auto& profile = recorder.read_profile()) {
+            json.add_string("filesystem", profile->filesystem);
+            json.add_number("blockSize", profile->block_size);
+            json.add_number("initialChunk", profile->initial_chunk);
+            json.add_number("finalChunk", profile->final_chunk);
+            json.add_number("readahead", profile->readahead);
+            json.add_number("bytesRead", profile->bytes_read);
+        }
+
+        std::string counters_json;
+        if (const PerfCounters* counters = recorder.perf_counters()) {
+            JsonBuilder per_phase;
+            for (std::size_t index = 0; index < kPhaseCount; ++index) {
+                const Phase phase = static_cast<Phase>(index);
+                const PerfSample& sample = recorder.counters(phase);
+                if (!has_counts(sample)) {
+                    continue;
+                }
+                JsonBuilder events;
+                for (std::size_t event = 0; event < kPerfEventCount; ++event) {
+                    if (counters->available(static_cast<PerfEvent>(event))) {
+                        events.add_number(perf_event_name(static_cast<PerfEvent>(event)), sample[event]);
+                    }
+                }
+                per_phase.add_raw(phase_name(phase), "{" + events.str() + "}");
+            }
+            counters_json = per_phase.str();
+        }
+
+        std::string allocations_json;
+        if (allocation_tracking_enabled()) {
+            JsonBuilder per_phase;
+            for (std::size_t index = 0; index <= kPhaseCount; ++index) {
+                const std::optional<Phase> phase = index < kPhaseCount ? std::optional<Phase>(static_cast<Phase>(index)) : std::nullopt;
+                const AllocationStats stats = thread_allocation_stats(phase);
+                if (stats.allocations == 0 && stats.frees == 0) {
+                    continue;
+                }
+                JsonBuilder entry;
+                entry.add_number("allocations", stats.allocations);
+                entry.add_number("frees", stats.frees);
+                entry.add_number("bytes", stats.bytes);
+                per_phase.add_raw(phase ? phase_name(*phase) : "unscoped", "{" + entry.str() + "}");
+            }
+            allocations_json = per_phase.str();
+        }
+
+        std::cerr << "{\"timings\":{" << phases.str() << "}";
+        if (recorder.perf_counters()) {
+            std::cerr << ",\"perfCounters\":{" << counters_json << "}";
+        }
+        if (allocation_tracking_enabled()) {
+            std::cerr << ",\"allocations\":{" << allocations_json << "}";
+        }
+        if (recorder.read_profile()) {
+            std::cerr << ",\"readStrategy\":{" << json.str() << "}";
+        }
+        std::cerr << "}\n";
+    }
 }
@@ -0,0 +1,219 @@
+#include <sched.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <charconv>
+#include <unistd.h>
+#include <iterator>
+#include <algorithm>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "file_probe/scheduling.hpp"
+
+namespace file_probe {
+
+    namespace {
+        // Values from linux/ioprio.h, spelled out so older kernel headers still build.
+        constexpr int kIoprioWhoProcess = 1;
+        constexpr int kIoprioClassShift = 13;
+        constexpr int kIoprioClassBestEffort = 2;
+        constexpr int kIoprioClassIdle = 3;
+        constexpr int kMaxBestEffortLevel = 7;
+        constexpr int kMempolicyPreferred = 1;
+        constexpr const char* kNodeRoot = "/sys/devices/system/node/";
+
+        std::optional<int> parse_int(std::string_view text) {
+            int value = 0;
+            const char* begin = text.data();
+            const char* end = text.data() + text.size();
+            auto [ptr, ec] = std::from_chars(begin, end, value);
+            if (ec != std::errc() || ptr != end || text.empty()) {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+        std::optional<std::string> read_sysfs_line(const std::string& path) {
+            std::ifstream file(path);
+            std::string line;
+            if (!file || !std::getline(file, line)) {
+                return std::nullopt;
+            }
+            return line;
+        }
+
+        std::optional<std::vector<int>> online_numa_nodes() {
+            auto online = read_sysfs_line(std::string(kNodeRoot) + "online");
+            if (!online) {
+                return std::nullopt;
+            }
+            return parse_cpu_list(*online);
+        }
+
+        std::optional<std::vector<int>> numa_node_cpus(int node) {
+            auto cpulist = read_sysfs_line(std::string(kNodeRoot) + "node" + std::to_string(node) + "/cpulist");
+            if (!cpulist) {
+                return std::nullopt;
+            }
+            return parse_cpu_list(*cpulist);
+        }
+
+        std::optional<int> numa_node_of_cpu(int cpu) {
+            auto nodes = online_numa_nodes();
+            if (!nodes) {
+                return std::nullopt;
+            }
+            for (int node : *nodes) {
+                auto cpus = numa_node_cpus(node);
+                if (cpus && std::binary_search(cpus->begin(), cpus->end(), cpu)) {
+                    return node;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Resolves the requested node and narrows the CPU set to it. Memory is
+        // then preferred from that node, so buffers first-touched by the probing
+        // thread stay node-local without linking libnuma.
+        void apply_numa_placement(int requested_node, std::vector<int>& cpus, std::vector<std::string>& warnings) {
+            int node = requested_node;
+            if (node == kNumaNodeAuto) {
+                const int current_cpu = sched_getcpu();
+                auto detected = current_cpu >= 0 ? numa_node_of_cpu(current_cpu) : std::nullopt;
+                if (!detected) {
+                    warnings.push_back("Unable to detect NUMA node of the current CPU.");
+                    return;
+                }
+                node = *detected;
+            }
+
+            auto node_cpus = numa_node_cpus(node);
+            if (!node_cpus) {
+                warnings.push_back("NUMA node " + std::to_string(node) + " is not available.");
+                return;
+            }
+
+            if (cpus.empty()) {
+                cpus = *node_cpus;
+            } else {
+                std::vector<int> narrowed;
+                std::set_intersection(cpus.begin(), cpus.end(), node_cpus->begin(), node_cpus->end(),
+                                    std::back_inserter(narrowed));
+                if (narrowed.empty()) {
+                    warnings.push_back("Requested CPUs do not belong to NUMA node " + std::to_string(node) + ".");
+                    return;
+                }
+                cpus = narrowed;
+            }
+
+            constexpr std::size_t kBitsPerWord = sizeof(unsigned long) * 8;
+            std::vector<unsigned long> node_mask(static_cast<std::size_t>(node) / kBitsPerWord + 1, 0);
+            node_mask[static_cast<std::size_t>(node) / kBitsPerWord] |= 1UL << (static_cast<std::size_t>(node) % kBitsPerWord);
+            if (syscall(SYS_set_mempolicy, kMempolicyPreferred, node_mask.data(), node_mask.size() * kBitsPerWord + 1) != 0) {
+                warnings.push_back("Unable to prefer memory from NUMA node " + std::to_string(node) + ": " +
+                                std::string(std::strerror(errno)));
+            }
+        }
+    }
+
+    std::optional<std::vector<int>> parse_cpu_list(const std::string& value) {
+        std::vector<int> cpus;
+        std::string_view remaining = value;
+
+        while (!remaining.empty()) {
+            std::size_t comma = remaining.find(',');
+            std::string_view item = remaining.substr(0, comma);
+            remaining = comma == std::string_view::npos ? std::string_view() : remaining.substr(comma + 1);
+
+            std::size_t dash = item.find('-');
+            auto first = parse_int(item.substr(0, dash));
+            auto last = dash == std::string_view::npos ? first : parse_int(item.substr(dash + 1));
+            if (!first || !last || *first < 0 || *last < *first || *last >= CPU_SETSIZE) {
+                return std::nullopt;
+            }
+            for (int cpu = *first; cpu <= *last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        if (cpus.empty()) {
+            return std::nullopt;
+        }
+
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        return cpus;
+    }
+
+    std::optional<IoPriority> parse_io_priority(const std::string& value) {
+        IoPriority priority;
+        if (value == "idle") {
+            priority.io_class = IoPriorityClass::Idle;
+            priority.level = 0;
+            return priority;
+        }
+        if (value.rfind("be:", 0) == 0) {
+            auto level = parse_int(std::string_view(value).substr(3));
+            if (!level || *level < 0 || *level > kMaxBestEffortLevel) {
+                return std::nullopt;
+            }
+            priority.io_class = IoPriorityClass::BestEffort;
+            priority.level = *level;
+            return priority;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<int> parse_numa_node(const std::string& value) {
+        if (value == "auto") {
+            return kNumaNodeAuto;
+        }
+        auto node = parse_int(value);
+        if (!node || *node < 0) {
+            return std::nullopt;
+        }
+        return node;
+    }
+
+    // Applied to the calling thread before any probing starts; threads spawned
+    // later inherit nice value, I/O priority and CPU mask from it.
+    std::vector<std::string> apply_scheduling(const SchedulingOptions& options) {
+        std::vector<std::string> warnings;
+
+        if (options.nice) {
+            errno = 0;
+            if (setpriority(PRIO_PROCESS, 0, *options.nice) != 0) {
+                warnings.push_back("Unable to set nice value: " + std::string(std::strerror(errno)));
+            }
+        }
+
+        if (options.io_priority) {
+            const int io_class = options.io_priority->io_class == IoPriorityClass::Idle
+                ? kIoprioClassIdle
+                : kIoprioClassBestEffort;
+            const int ioprio = (io_class << kIoprioClassShift) | options.io_priority->level;
+            if (syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, ioprio) != 0) {
+                warnings.push_back("Unable to set I/O priority: " + std::string(std::strerror(errno)));
+            }
+        }
+
+        std::vector<int> cpus = options.cpus;
+        if (options.numa_node) {
+            apply_numa_placement(*options.numa_node, cpus, warnings);
+        }
+
+        if (!cpus.empty()) {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            for (int cpu : cpus) {
+                CPU_SET(cpu, &mask);
+            }
+            if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+                warnings.push_back("Unable to set CPU affinity: " + std::string(std::strerror(errno)));
+            }
+        }
+
+        return warnings;
+    }
+}
@@ -0,0 +1,285 @@
+#include <grp.h>
+#include <pwd.h>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <utility>
+#include <unistd.h>
+#include <algorithm>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/xattr.h>
+#include <string_view>
+#include "file_probe/security.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr const char* kAclAccessName = "system.posix_acl_access";
+        constexpr const char* kAclDefaultName = "system.posix_acl_default";
+        constexpr const char* kCapabilityName = "security.capability";
+
+        // Layouts from linux/posix_acl_xattr.h and linux/capability.h.
+        constexpr std::uint32_t kAclXattrVersion = 2;
+        constexpr std::size_t kAclHeaderSize = 4;
+        constexpr std::size_t kAclEntrySize = 8;
+        constexpr std::uint16_t kAclUserObj = 0x01;
+        constexpr std::uint16_t kAclUser = 0x02;
+        constexpr std::uint16_t kAclGroupObj = 0x04;
+        constexpr std::uint16_t kAclGroup = 0x08;
+        constexpr std::uint16_t kAclMask = 0x10;
+        constexpr std::uint16_t kAclOther = 0x20;
+
+        constexpr std::uint32_t kCapRevisionMask = 0xFF000000U;
+        constexpr std::uint32_t kCapRevision1 = 0x01000000U;
+        constexpr std::uint32_t kCapFlagEffective = 0x000001U;
+
+        constexpr std::array<std::string_view, 41> kCapabilityNames = {
+            "chown", "dac_override", "dac_read_search", "fowner", "fsetid", "kill", "setgid", "setuid",
+            "setpcap", "linux_immutable", "net_bind_service", "net_broadcast", "net_admin", "net_raw",
+            "ipc_lock", "ipc_owner", "sys_module", "sys_rawio", "sys_chroot", "sys_ptrace", "sys_pacct",
+            "sys_admin", "sys_boot", "sys_nice", "sys_resource", "sys_time", "sys_tty_config", "mknod",
+            "lease", "audit_write", "audit_control", "setfcap", "mac_override", "mac_admin", "syslog",
+            "wake_alarm", "block_suspend", "audit_read", "perfmon", "bpf", "checkpoint_restore"};
+
+        struct FlagName {
+            long flag;
+            const char* name;
+        };
+
+        constexpr std::array<FlagName, 8> kFileFlags = {{
+            {FS_IMMUTABLE_FL, "immutable"},
+            {FS_APPEND_FL, "append-only"},
+            {FS_NODUMP_FL, "nodump"},
+            {FS_NOATIME_FL, "noatime"},
+            {FS_SYNC_FL, "sync"},
+            {FS_COMPR_FL, "compressed"},
+            {FS_NOCOW_FL, "nocow"},
+            {FS_DIRSYNC_FL, "dirsync"},
+        }};
+
+        std::uint32_t read_le32(const std::uint8_t* data) {
+            return static_cast<std::uint32_t>(data[0]) |
+                (static_cast<std::uint32_t>(data[1]) << 8) |
+                (static_cast<std::uint32_t>(data[2]) << 16) |
+                (static_cast<std::uint32_t>(data[3]) << 24);
+        }
+
+        std::uint16_t read_le16(const std::uint8_t* data) {
+            return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+        }
+
+        std::optional<std::vector<std::uint8_t>> read_xattr(int fd, const char* name) {
+            ssize_t length = fgetxattr(fd, name, nullptr, 0);
+            if (length <= 0) {
+                return std::nullopt;
+            }
+            std::vector<std::uint8_t> value(static_cast<std::size_t>(length));
+            length = fgetxattr(fd, name, value.data(), value.size());
+            if (length <= 0) {
+                return std::nullopt;
+            }
+            value.resize(static_cast<std::size_t>(length));
+            return value;
+        }
+
+        std::string user_name(std::uint32_t uid) {
+            if (struct passwd* pwd = getpwuid(uid); pwd && pwd->pw_name) {
+                return pwd->pw_name;
+            }
+            return std::to_string(uid);
+        }
+
+        std::string group_name(std::uint32_t gid) {
+            if (struct group* grp = getgrgid(gid); grp && grp->gr_name) {
+                return grp->gr_name;
+            }
+            return std::to_string(gid);
+        }
+
+        std::optional<std::string> decode_acl(const std::vector<std::uint8_t>& value) {
+            if (value.size() < kAclHeaderSize || read_le32(value.data()) != kAclXattrVersion) {
+                return std::nullopt;
+            }
+
+            std::string text;
+            for (std::size_t offset = kAclHeaderSize; offset + kAclEntrySize <= value.size(); offset += kAclEntrySize) {
+                const std::uint16_t tag = read_le16(value.data() + offset);
+                const std::uint16_t perm = read_le16(value.data() + offset + 2);
+                const std::uint32_t id = read_le32(value.data() + offset + 4);
+
+                std::string entry;
+                switch (tag) {
+                    case kAclUserObj: entry = "user::"; break;
+                    case kAclUser: entry = "user:" + user_name(id) + ":"; break;
+                    case kAclGroupObj: entry = "group::"; break;
+                    case kAclGroup: entry = "group:" + group_name(id) + ":"; break;
+                    case kAclMask: entry = "mask::"; break;
+                    case kAclOther: entry = "other::"; break;
+                    default: continue;
+                }
+                entry += (perm & 4) ? 'r' : '-';
+                entry += (perm & 2) ? 'w' : '-';
+                entry += (perm & 1) ? 'x' : '-';
+
+                if (!text.empty()) {
+                    text += ',';
+                }
+                text += entry;
+            }
+            return text;
+        }
+
+        // Renders in getcap style, grouping capabilities that share the same
+        // effective/inheritable/permitted set, e.g. "cap_net_raw,cap_net_admin=ep".
+        std::optional<std::string> decode_capabilities(const std::vector<std::uint8_t>& value) {
+            if (value.size() < 12) {
+                return std::nullopt;
+            }
+
+            const std::uint32_t magic = read_le32(value.data());
+            const bool effective = (magic & kCapFlagEffective) != 0;
+            const std::size_t words = (magic & kCapRevisionMask) == kCapRevision1 ? 1 : 2;
+            if (value.size() < 4 + words * 8) {
+                return std::nullopt;
+            }
+
+            std::uint64_t permitted = 0;
+            std::uint64_t inheritable = 0;
+            for (std::size_t word = 0; word < words; ++word) {
+                permitted |= static_cast<std::uint64_t>(read_le32(value.data() + 4 + word * 8)) << (32 * word);
+                inheritable |= static_cast<std::uint64_t>(read_le32(value.data() + 8 + word * 8)) << (32 * word);
+            }
+
+            std::vector<std::pair<std::string, std::string>> groups;
+            for (std::size_t bit = 0; bit < 64; ++bit) {
+                const bool in_permitted = (permitted >> bit) & 1U;
+                const bool in_inheritable = (inheritable >> bit) & 1U;
+                if (!in_permitted && !in_inheritable) {
+                    continue;
+                }
+
+                std::string flags;
+                if (effective && in_permitted) flags += 'e';
+                if (in_inheritable) flags += 'i';
+                if (in_permitted) flags += 'p';
+
+                const std::string name = bit < kCapabilityNames.size()
+                    ? "cap_" + std::string(kCapabilityNames[bit])
+                    : "cap_" + std::to_string(bit);
+
+                auto group = std::find_if(groups.begin(), groups.end(), [&](const auto& item) {
+                    return item.second == flags;
+                });
+                if (group == groups.end()) {
+                    groups.emplace_back(name, flags);
+                } else {
+                    group->first += "," + name;
+                }
+            }
+
+            if (groups.empty()) {
+                return std::nullopt;
+            }
+
+            std::string text;
+            for (const auto& [names, flags] : groups) {
+                if (!text.empty()) {
+                    text += ' ';
+                }
+                text += names + "=" + flags;
+            }
+            return text;
+        }
+
+        std::optional<long> read_file_flags(int fd) {
+            int flags = 0;
+            if (ioctl(fd, FS_IOC_GETFLAGS, &flags) != 0) {
+                return std::nullopt;
+            }
+            return static_cast<long>(flags);
+        }
+
+        // fgetxattr rejects O_PATH descriptors; /proc/self/fd still resolves
+        // them to the opened inode, never to whatever the name points at now.
+        bool has_xattr(int fd, const char* name) {
+            const ssize_t length = fgetxattr(fd, name, nullptr, 0);
+            if (length >= 0 || errno != EBADF) {
+                return length > 0;
+            }
+            const std::string proc_path = "/proc/self/fd/" + std::to_string(fd);
+            return getxattr(proc_path.c_str(), name, nullptr, 0) > 0;
+        }
+    }
+
+    SecurityInfo collect_security_info(int fd, mode_t mode, std::vector<std::string>& warnings) {
+        SecurityInfo info;
+        info.setuid = (mode & S_ISUID) != 0;
+        info.setgid = (mode & S_ISGID) != 0;
+        info.sticky = (mode & S_ISVTX) != 0;
+
+        ssize_t length = flistxattr(fd, nullptr, 0);
+        if (length > 0) {
+            std::vector<char> names(static_cast<std::size_t>(length));
+            length = flistxattr(fd, names.data(), names.size());
+            for (ssize_t offset = 0; length > 0 && offset < length;) {
+                std::string name(names.data() + offset);
+                offset += static_cast<ssize_t>(name.size()) + 1;
+                if (!name.empty()) {
+                    info.xattrs.push_back(std::move(name));
+                }
+            }
+        } else if (length < 0 && errno != ENOTSUP) {
+            warnings.push_back("Unable to list extended attributes: " + std::string(std::strerror(errno)));
+        }
+
+        if (auto value = read_xattr(fd, kAclAccessName)) {
+            info.acl = decode_acl(*value);
+        }
+        if (S_ISDIR(mode)) {
+            if (auto value = read_xattr(fd, kAclDefaultName)) {
+                info.default_acl = decode_acl(*value);
+            }
+        }
+        if (auto value = read_xattr(fd, kCapabilityName)) {
+            info.capabilities = decode_capabilities(*value);
+        }
+
+        if (auto flags = read_file_flags(fd)) {
+            for (const auto& item : kFileFlags) {
+                if (*flags & item.flag) {
+                    info.flags.emplace_back(item.name);
+                }
+            }
+        }
+
+        return info;
+    }
+
+    void accumulate_security(int fd, mode_t mode, SecuritySummary& summary) {
+        if (mode & S_ISUID) ++summary.setuid_count;
+        if (mode & S_ISGID) ++summary.setgid_count;
+        if (mode & S_ISVTX) ++summary.sticky_count;
+
+        if (fd < 0 || S_ISLNK(mode)) {
+            return;
+        }
+
+        if (S_ISREG(mode) && has_xattr(fd, kCapabilityName)) {
+            ++summary.capability_count;
+        }
+        if (has_xattr(fd, kAclAccessName) || (S_ISDIR(mode) && has_xattr(fd, kAclDefaultName))) {
+            ++summary.acl_count;
+        }
+
+        if (!S_ISREG(mode) && !S_ISDIR(mode)) {
+            return;
+        }
+        if (auto flags = read_file_flags(fd)) {
+            if (*flags & FS_IMMUTABLE_FL) ++summary.immutable_count;
+            if (*flags & FS_APPEND_FL) ++summary.append_only_count;
+        }
+    }
+}
@@ -0,0 +1,474 @@
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include "file_probe/shard.hpp"
+#include "file_probe/utils.hpp"
+#include "file_probe/sketch.hpp"
+#include "file_probe/binary_io.hpp"
+#include "file_probe/grouping.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr char kPartialMagic[8] = {'F', 'P', 'P', 'A', 'R', 'T', '\0', '\4'};
+
+        struct Partial {
+            std::string root;
+            ShardSpec shard;
+            FileReport report;
+        };
+
+        void write_kll(BinaryWriter& writer, const KllSketch& sketch) {
+            writer.put_u64(sketch.count());
+            writer.put_u64(sketch.levels().size());
+            for (const auto& level : sketch.levels()) {
+                writer.put_u64(level.size());
+                for (double value : level) {
+                    writer.put_double(value);
+                }
+            }
+        }
+
+        void read_kll(BinaryReader& reader, KllSketch& sketch) {
+            const std::uint64_t count = reader.get_u64();
+            std::vector<std::vector<double>> levels(reader.get_count(8));
+            for (auto& level : levels) {
+                level.resize(reader.get_count(8));
+                for (double& value : level) {
+                    value = reader.get_double();
+                }
+            }
+            if (reader.ok()) {
+                sketch.restore(count, std::move(levels));
+            }
+        }
+
+        void write_sketches(BinaryWriter& writer, const SketchSet& sketches) {
+            writer.put_u64(sketches.hashed_files);
+            writer.put_bytes(sketches.distinct_content.registers().data(), HyperLogLog::kRegisterCount);
+            write_kll(writer, sketches.size_bytes);
+            write_kll(writer, sketches.age_days);
+            for (std::uint32_t counter : sketches.extensions.counters()) {
+                writer.put_u32(counter);
+            }
+            writer.put_u64(sketches.extensions.candidates().size());
+            for (const auto& candidate : sketches.extensions.candidates()) {
+                writer.put_string(candidate);
+            }
+        }
+
+        void read_sketches(BinaryReader& reader, SketchSet& sketches) {
+            sketches.hashed_files = reader.get_u64();
+            reader.get_bytes(sketches.distinct_content.registers().data(), HyperLogLog::kRegisterCount);
+            read_kll(reader, sketches.size_bytes);
+            read_kll(reader, sketches.age_days);
+            for (std::uint32_t& counter : sketches.extensions.counters()) {
+                counter = reader.get_u32();
+            }
+            const std::size_t candidates = reader.get_count(8);
+            for (std::size_t i = 0; i < candidates && reader.ok(); ++i) {
+                sketches.extensions.add_candidate(reader.get_string());
+            }
+        }
+
+        void write_detail(BinaryWriter& writer, const DirectoryDetail& detail) {
+            writer.put_u64(detail.total_size_bytes);
+            writer.put_u64(detail.file_count);
+            writer.put_u64(detail.directory_count);
+            writer.put_u64(detail.symlinks.symlink_count);
+            writer.put_u64(detail.symlinks.broken_count);
+            writer.put_u64(detail.symlinks.followed_count);
+            writer.put_u64(detail.symlinks.loop_count);
+            writer.put_u64(detail.symlinks.dangling.size());
+            for (const auto& dangling : detail.symlinks.dangling) {
+                writer.put_string(dangling);
+            }
+
+            writer.put_u8(detail.security ? 1 : 0);
+            if (detail.security) {
+                writer.put_u64(detail.security->setuid_count);
+                writer.put_u64(detail.security->setgid_count);
+                writer.put_u64(detail.security->sticky_count);
+                writer.put_u64(detail.security->capability_count);
+                writer.put_u64(detail.security->acl_count);
+                writer.put_u64(detail.security->immutable_count);
+                writer.put_u64(detail.security->append_only_count);
+            }
+
+            writer.put_u8(detail.extents ? 1 : 0);
+            if (detail.extents) {
+                writer.put_u64(detail.extents->files_mapped);
+                writer.put_u64(detail.extents->files_unmapped);
+                writer.put_u64(detail.extents->total_extents);
+                writer.put_u64(detail.extents->fragmented_files);
+                writer.put_u64(detail.extents->files_with_shared_extents);
+                writer.put_u64(detail.extents->shared_bytes);
+                writer.put_optional_string(detail.extents->most_fragmented_path);
+                writer.put_u64(detail.extents->most_fragmented_count);
+            }
+
+            writer.put_u8(detail.matches ? 1 : 0);
+            if (detail.matches) {
+                writer.put_u64(detail.match_count);
+                writer.put_u64(detail.matches->size());
+                for (const auto& match : *detail.matches) {
+                    writer.put_string(match.path);
+                    writer.put_string(match.type);
+                    writer.put_u64(match.size_bytes);
+                }
+            }
+
+            writer.put_u8(detail.groups ? 1 : 0);
+            if (detail.groups) {
+                writer.put_u8(static_cast<std::uint8_t>(detail.groups->key));
+                writer.put_u64(detail.groups->rows.size());
+                for (const auto& row : detail.groups->rows) {
+                    writer.put_string(row.key);
+                    writer.put_u64(row.count);
+                    writer.put_u64(row.total_size_bytes);
+                    writer.put_u64(row.max_size_bytes);
+                    writer.put_u64(static_cast<std::uint64_t>(row.newest_mtime));
+                }
+            }
+
+            writer.put_u8(detail.sketches ? 1 : 0);
+            if (detail.sketches) {
+                write_sketches(writer, *detail.sketches);
+            }
+
+            writer.put_u8(detail.hashset ? 1 : 0);
+            if (detail.hashset) {
+                writer.put_u64(detail.hashset->checked_files);
+                writer.put_u64(detail.hashset->matched_files);
+                writer.put_u64(detail.hashset->matched.size());
+                for (const auto& matched : detail.hashset->matched) {
+                    writer.put_string(matched);
+                }
+            }
+        }
+
+        DirectoryDetail read_detail(BinaryReader& reader) {
+            DirectoryDetail detail;
+            detail.total_size_bytes = reader.get_u64();
+            detail.file_count = reader.get_u64();
+            detail.directory_count = reader.get_u64();
+            detail.symlinks.symlink_count = reader.get_u64();
+            detail.symlinks.broken_count = reader.get_u64();
+            detail.symlinks.followed_count = reader.get_u64();
+            detail.symlinks.loop_count = reader.get_u64();
+            detail.symlinks.dangling.resize(reader.get_count(8));
+            for (auto& dangling : detail.symlinks.dangling) {
+                dangling = reader.get_string();
+            }
+
+            if (reader.get_u8()) {
+                SecuritySummary& security = detail.security.emplace();
+                security.setuid_count = reader.get_u64();
+                security.setgid_count = reader.get_u64();
+                security.sticky_count = reader.get_u64();
+                security.capability_count = reader.get_u64();
+                security.acl_count = reader.get_u64();
+                security.immutable_count = reader.get_u64();
+                security.append_only_count = reader.get_u64();
+            }
+
+            if (reader.get_u8()) {
+                ExtentSummary& extents = detail.extents.emplace();
+                extents.files_mapped = reader.get_u64();
+                extents.files_unmapped = reader.get_u64();
+                extents.total_extents = reader.get_u64();
+                extents.fragmented_files = reader.get_u64();
+                extents.files_with_shared_extents = reader.get_u64();
+                extents.shared_bytes = reader.get_u64();
+                extents.most_fragmented_path = reader.get_optional_string();
+                extents.most_fragmented_count = reader.get_u64();
+            }
+
+            if (reader.get_u8()) {
+                auto& matches = detail.matches.emplace();
+                detail.match_count = reader.get_u64();
+                matches.resize(reader.get_count(24));
+                for (auto& match : matches) {
+                    match.path = reader.get_string();
+                    match.type = reader.get_string();
+                    match.size_bytes = reader.get_u64();
+                }
+            }
+
+            if (reader.get_u8()) {
+                GroupSummary& groups = detail.groups.emplace();
+                const std::uint8_t key = reader.get_u8();
+                if (key > static_cast<std::uint8_t>(GroupKey::Depth)) {
+                    reader.fail();
+                }
+                groups.key = static_cast<GroupKey>(key);
+                groups.rows.resize(reader.get_count(40));
+                for (auto& row : groups.rows) {
+                    row.key = reader.get_string();
+                    row.count = reader.get_u64();
+                    row.total_size_bytes = reader.get_u64();
+                    row.max_size_bytes = reader.get_u64();
+                    row.newest_mtime = static_cast<std::time_t>(reader.get_u64());
+                }
+            }
+
+            if (reader.get_u8()) {
+                read_sketches(reader, detail.sketches.emplace());
+            }
+
+            if (reader.get_u8()) {
+                HashSetSummary& hashset = detail.hashset.emplace();
+                hashset.checked_files = reader.get_u64();
+                hashset.matched_files = reader.get_u64();
+                hashset.matched.resize(reader.get_count(8));
+                for (auto& matched : hashset.matched) {
+                    matched = reader.get_string();
+                }
+            }
+            return detail;
+        }
+
+        std::optional<Partial> read_partial(const std::string& path, std::string& error) {
+            const auto contents = read_binary_file(path);
+            if (!contents) {
+                error = "Unable to open partial " + path;
+                return std::nullopt;
+            }
+            const std::string& data = *contents;
+            if (data.size() < sizeof(kPartialMagic) || std::memcmp(data.data(), kPartialMagic, sizeof(kPartialMagic)) != 0) {
+                error = path + " is not a file-probe partial";
+                return std::nullopt;
+            }
+
+            BinaryReader reader(data);
+            char magic[sizeof(kPartialMagic)];
+            reader.get_bytes(magic, sizeof(magic));
+
+            Partial partial;
+            partial.root = reader.get_string();
+            partial.shard.index = reader.get_u64();
+            partial.shard.count = reader.get_u64();
+            partial.report.permissions = reader.get_optional_string();
+            if (reader.get_u8()) {
+                OwnershipInfo& ownership = partial.report.ownership.emplace();
+                ownership.owner = reader.get_string();
+                ownership.group = reader.get_string();
+            }
+            if (reader.get_u8()) {
+                TimeInfo& timestamps = partial.report.timestamps.emplace();
+                timestamps.last_access = reader.get_string();
+                timestamps.last_modify = reader.get_string();
+                timestamps.last_change = reader.get_string();
+            }
+            partial.report.directory_detail = read_detail(reader);
+            partial.report.warnings.resize(reader.get_count(8));
+            for (auto& warning : partial.report.warnings) {
+                warning = reader.get_string();
+            }
+
+            if (!reader.ok() || !reader.at_end() || partial.shard.count == 0 || partial.shard.index >= partial.shard.count) {
+                error = path + " is truncated or corrupt";
+                return std::nullopt;
+            }
+            return partial;
+        }
+
+        // Partials must come from the same options; merging a shard that
+        // tracked extents with one that did not would silently undercount.
+        bool same_sections(const DirectoryDetail& left, const DirectoryDetail& right) {
+            return left.security.has_value() == right.security.has_value() &&
+                   left.extents.has_value() == right.extents.has_value() &&
+                   left.matches.has_value() == right.matches.has_value() &&
+                   left.groups.has_value() == right.groups.has_value() &&
+                   (!left.groups || left.groups->key == right.groups->key) &&
+                   left.sketches.has_value() == right.sketches.has_value() &&
+                   left.hashset.has_value() == right.hashset.has_value();
+        }
+
+        void merge_detail(DirectoryDetail& into, const DirectoryDetail& from) {
+            into.total_size_bytes += from.total_size_bytes;
+            into.file_count += from.file_count;
+            into.directory_count += from.directory_count;
+            into.symlinks.symlink_count += from.symlinks.symlink_count;
+            into.symlinks.broken_count += from.symlinks.broken_count;
+            into.symlinks.followed_count += from.symlinks.followed_count;
+            into.symlinks.loop_count += from.symlinks.loop_count;
+            into.symlinks.dangling.insert(into.symlinks.dangling.end(), from.symlinks.dangling.begin(),
+                                          from.symlinks.dangling.end());
+
+            if (into.security && from.security) {
+                into.security->setuid_count += from.security->setuid_count;
+                into.security->setgid_count += from.security->setgid_count;
+                into.security->sticky_count += from.security->sticky_count;
+                into.security->capability_count += from.security->capability_count;
+                into.security->acl_count += from.security->acl_count;
+                into.security->immutable_count += from.security->immutable_count;
+                into.security->append_only_count += from.security->append_only_count;
+            }
+
+            if (into.extents && from.extents) {
+                into.extents->files_mapped += from.extents->files_mapped;
+                into.extents->files_unmapped += from.extents->files_unmapped;
+                into.extents->total_extents += from.extents->total_extents;
+                into.extents->fragmented_files += from.extents->fragmented_files;
+                into.extents->files_with_shared_extents += from.extents->files_with_shared_extents;
+                into.extents->shared_bytes += from.extents->shared_bytes;
+                if (from.extents->most_fragmented_count > into.extents->most_fragmented_count) {
+                    into.extents->most_fragmented_path = from.extents->most_fragmented_path;
+                    into.extents->most_fragmented_count = from.extents->most_fragmented_count;
+                }
+            }
+
+            if (into.matches && from.matches) {
+                into.match_count += from.match_count;
+                into.matches->insert(into.matches->end(), from.matches->begin(), from.matches->end());
+            }
+
+            if (into.groups && from.groups) {
+                GroupTable table;
+                for (const auto& row : into.groups->rows) {
+                    table.add(row);
+                }
+                for (const auto& row : from.groups->rows) {
+                    table.add(row);
+                }
+                into.groups = table.summary(into.groups->key);
+            }
+
+            if (into.sketches && from.sketches) {
+                into.sketches->merge(*from.sketches);
+            }
+
+            if (into.hashset && from.hashset) {
+                into.hashset->checked_files += from.hashset->checked_files;
+                into.hashset->matched_files += from.hashset->matched_files;
+                into.hashset->matched.insert(into.hashset->matched.end(), from.hashset->matched.begin(),
+                                             from.hashset->matched.end());
+            }
+        }
+    }
+
+    std::optional<ShardSpec> parse_shard(const std::string& value) {
+        const auto slash = value.find('/');
+        if (slash == std::string::npos) {
+            return std::nullopt;
+        }
+        ShardSpec shard;
+        const char* begin = value.data();
+        const char* middle = begin + slash;
+        const char* end = begin + value.size();
+        auto [index_end, index_error] = std::from_chars(begin, middle, shard.index);
+        auto [count_end, count_error] = std::from_chars(middle + 1, end, shard.count);
+        if (index_error != std::errc() || index_end != middle || count_error != std::errc() || count_end != end ||
+            shard.count == 0 || shard.index >= shard.count) {
+            return std::nullopt;
+        }
+        return shard;
+    }
+
+    bool shard_owns(const ShardSpec& shard, const std::string& key) {
+        return shard.count <= 1 || hash64(key.data(), key.size()) % shard.count == shard.index;
+    }
+
+    bool write_partial(const std::string& path, const FileReport& report, const ShardSpec& shard, std::string& error) {
+        if (!report.directory_detail) {
+            error = "Partials can only be written for directories";
+            return false;
+        }
+        if (report.directory_detail->physical_usage) {
+            error = "Physical usage cannot be split across shards";
+            return false;
+        }
+
+        BinaryWriter writer;
+        writer.put_bytes(kPartialMagic, sizeof(kPartialMagic));
+        writer.put_string(report.absolute_path.lexically_normal().string());
+        writer.put_u64(shard.index);
+        writer.put_u64(shard.count);
+        writer.put_optional_string(report.permissions);
+        writer.put_u8(report.ownership ? 1 : 0);
+        if (report.ownership) {
+            writer.put_string(report.ownership->owner);
+            writer.put_string(report.ownership->group);
+        }
+        writer.put_u8(report.timestamps ? 1 : 0);
+        if (report.timestamps) {
+            writer.put_string(report.timestamps->last_access);
+            writer.put_string(report.timestamps->last_modify);
+            writer.put_string(report.timestamps->last_change);
+        }
+        write_detail(writer, *report.directory_detail);
+        writer.put_u64(report.warnings.size());
+        for (const auto& warning : report.warnings) {
+            writer.put_string(warning);
+        }
+
+        return write_binary_file(path, writer.data(), error);
+    }
+
+    std::optional<FileReport> merge_partials(const std::vector<std::string>& paths, std::string& error) {
+        if (paths.empty()) {
+            error = "No partials to merge";
+            return std::nullopt;
+        }
+
+        FileReport merged;
+        std::vector<bool> seen;
+        std::string root;
+        for (const auto& path : paths) {
+            auto partial = read_partial(path, error);
+            if (!partial) {
+                return std::nullopt;
+            }
+
+            if (seen.empty()) {
+                root = partial->root;
+                seen.assign(partial->shard.count, false);
+                merged = std::move(partial->report);
+                merged.input_path = root;
+                merged.absolute_path = root;
+                merged.target_exists = true;
+                merged.type = "Directory";
+                seen[partial->shard.index] = true;
+                continue;
+            }
+
+            if (partial->root != root) {
+                error = path + " was collected for " + partial->root + ", not " + root;
+                return std::nullopt;
+            }
+            if (partial->shard.count != seen.size()) {
+                error = path + " uses " + std::to_string(partial->shard.count) + " shards, expected " +
+                        std::to_string(seen.size());
+                return std::nullopt;
+            }
+            if (seen[partial->shard.index]) {
+                error = "Shard " + std::to_string(partial->shard.index) + " was given more than once";
+                return std::nullopt;
+            }
+            if (!same_sections(*merged.directory_detail, *partial->report.directory_detail)) {
+                error = path + " was collected with different options";
+                return std::nullopt;
+            }
+            seen[partial->shard.index] = true;
+            merge_detail(*merged.directory_detail, *partial->report.directory_detail);
+            merged.warnings.insert(merged.warnings.end(), partial->report.warnings.begin(), partial->report.warnings.end());
+        }
+
+        for (std::size_t index = 0; index < seen.size(); ++index) {
+            if (!seen[index]) {
+                merged.warnings.push_back("Missing partial for shard " + std::to_string(index) + "/" +
+                                          std::to_string(seen.size()) + "; totals are incomplete");
+            }
+        }
+
+        DirectoryDetail& detail = *merged.directory_detail;
+        if (detail.matches) {
+            std::sort(detail.matches->begin(), detail.matches->end(), [](const MatchedEntry& left, const MatchedEntry& right) {
+                return left.path < right.path;
+            });
+        }
+        detail.total_size_human = format_size(detail.total_size_bytes);
+        return merged;
+    }
+}
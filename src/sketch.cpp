@@ -0,0 +1,237 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "file_probe/sketch.hpp"
+
+namespace file_probe {
+
+    namespace {
+        std::uint64_t mix64(std::uint64_t value) {
+            value ^= value >> 30;
+            value *= 0xbf58476d1ce4e5b9ULL;
+            value ^= value >> 27;
+            value *= 0x94d049bb133111ebULL;
+            value ^= value >> 31;
+            return value;
+        }
+
+        std::uint32_t saturating_add(std::uint32_t left, std::uint64_t right) {
+            const std::uint64_t sum = static_cast<std::uint64_t>(left) + right;
+            return sum > std::numeric_limits<std::uint32_t>::max()
+                ? std::numeric_limits<std::uint32_t>::max()
+                : static_cast<std::uint32_t>(sum);
+        }
+    }
+
+    std::uint64_t hash64(const void* data, std::size_t length, std::uint64_t seed) {
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+        std::uint64_t hash = 0xcbf29ce484222325ULL ^ mix64(seed);
+        for (std::size_t index = 0; index < length; ++index) {
+            hash ^= bytes[index];
+            hash *= 0x100000001b3ULL;
+        }
+        return mix64(hash);
+    }
+
+    void HyperLogLog::add(std::uint64_t hash) {
+        const std::size_t index = static_cast<std::size_t>(hash >> (64 - kPrecision));
+        const std::uint64_t remaining = (hash << kPrecision) | (std::uint64_t(1) << (kPrecision - 1));
+        const auto rank = static_cast<std::uint8_t>(__builtin_clzll(remaining) + 1);
+        registers_[index] = std::max(registers_[index], rank);
+    }
+
+    void HyperLogLog::merge(const HyperLogLog& other) {
+        for (std::size_t index = 0; index < kRegisterCount; ++index) {
+            registers_[index] = std::max(registers_[index], other.registers_[index]);
+        }
+    }
+
+    std::uint64_t HyperLogLog::estimate() const {
+        const double m = static_cast<double>(kRegisterCount);
+        double sum = 0.0;
+        std::size_t zeros = 0;
+        for (std::uint8_t value : registers_) {
+            sum += std::ldexp(1.0, -static_cast<int>(value));
+            if (value == 0) {
+                ++zeros;
+            }
+        }
+
+        const double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double estimate = alpha * m * m / sum;
+        if (estimate <= 2.5 * m && zeros > 0) {
+            // Linear counting is more accurate while many registers are empty.
+            estimate = m * std::log(m / static_cast<double>(zeros));
+        }
+        return static_cast<std::uint64_t>(std::llround(estimate));
+    }
+
+    KllSketch::KllSketch(std::size_t k) : k_(std::max<std::size_t>(k, 8)), levels_(1) {}
+
+    std::size_t KllSketch::capacity(std::size_t level) const {
+        const std::size_t height = levels_.size();
+        const double scaled = static_cast<double>(k_) * std::pow(2.0 / 3.0, static_cast<double>(height - 1 - level));
+        return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(scaled)));
+    }
+
+    void KllSketch::add(double value) {
+        levels_[0].push_back(value);
+        ++count_;
+        compress();
+    }
+
+    void KllSketch::compress() {
+        while (true) {
+            std::size_t stored = 0;
+            std::size_t total_capacity = 0;
+            for (std::size_t level = 0; level < levels_.size(); ++level) {
+                stored += levels_[level].size();
+                total_capacity += capacity(level);
+            }
+            if (stored <= total_capacity) {
+                return;
+            }
+
+            for (std::size_t level = 0; level < levels_.size(); ++level) {
+                if (levels_[level].size() < capacity(level)) {
+                    continue;
+                }
+                if (level + 1 == levels_.size()) {
+                    levels_.emplace_back();
+                }
+
+                // Halve the level: sort, promote every other item one level up
+                // (doubling its weight) and keep an odd leftover in place.
+                std::vector<double>& items = levels_[level];
+                std::sort(items.begin(), items.end());
+                std::vector<double> leftover;
+                if (items.size() % 2 == 1) {
+                    leftover.push_back(items.back());
+                    items.pop_back();
+                }
+                const std::size_t offset = compaction_parity_ ? 1 : 0;
+                compaction_parity_ = !compaction_parity_;
+                std::vector<double>& upper = levels_[level + 1];
+                for (std::size_t index = offset; index < items.size(); index += 2) {
+                    upper.push_back(items[index]);
+                }
+                levels_[level] = std::move(leftover);
+                break;
+            }
+        }
+    }
+
+    void KllSketch::merge(const KllSketch& other) {
+        if (other.levels_.size() > levels_.size()) {
+            levels_.resize(other.levels_.size());
+        }
+        for (std::size_t level = 0; level < other.levels_.size(); ++level) {
+            levels_[level].insert(levels_[level].end(), other.levels_[level].begin(), other.levels_[level].end());
+        }
+        count_ += other.count_;
+        compress();
+    }
+
+    double KllSketch::quantile(double rank) const {
+        std::vector<std::pair<double, std::uint64_t>> weighted;
+        std::uint64_t total = 0;
+        for (std::size_t level = 0; level < levels_.size(); ++level) {
+            const std::uint64_t weight = std::uint64_t(1) << level;
+            for (double value : levels_[level]) {
+                weighted.emplace_back(value, weight);
+                total += weight;
+            }
+        }
+        if (weighted.empty()) {
+            return 0.0;
+        }
+
+        std::sort(weighted.begin(), weighted.end());
+        const double target = std::clamp(rank, 0.0, 1.0) * static_cast<double>(total);
+        std::uint64_t cumulative = 0;
+        for (const auto& [value, weight] : weighted) {
+            cumulative += weight;
+            if (static_cast<double>(cumulative) >= target) {
+                return value;
+            }
+        }
+        return weighted.back().first;
+    }
+
+    void KllSketch::restore(std::uint64_t count, std::vector<std::vector<double>> levels) {
+        count_ = count;
+        levels_ = std::move(levels);
+        if (levels_.empty()) {
+            levels_.resize(1);
+        }
+        compress();
+    }
+
+    void CountMinSketch::add(const std::string& key, std::uint64_t amount) {
+        for (std::size_t row = 0; row < kDepth; ++row) {
+            const std::size_t column = hash64(key.data(), key.size(), row + 1) % kWidth;
+            std::uint32_t& counter = counters_[row * kWidth + column];
+            counter = saturating_add(counter, amount);
+        }
+        add_candidate(key);
+    }
+
+    void CountMinSketch::add_candidate(const std::string& key) {
+        if (std::find(candidates_.begin(), candidates_.end(), key) != candidates_.end()) {
+            return;
+        }
+        if (candidates_.size() < kCandidates) {
+            candidates_.push_back(key);
+            return;
+        }
+        auto weakest = std::min_element(candidates_.begin(), candidates_.end(), [&](const auto& left, const auto& right) {
+            return estimate(left) < estimate(right);
+        });
+        if (estimate(key) > estimate(*weakest)) {
+            *weakest = key;
+        }
+    }
+
+    void CountMinSketch::merge(const CountMinSketch& other) {
+        for (std::size_t index = 0; index < counters_.size(); ++index) {
+            counters_[index] = saturating_add(counters_[index], other.counters_[index]);
+        }
+        for (const auto& key : other.candidates_) {
+            add_candidate(key);
+        }
+    }
+
+    std::uint64_t CountMinSketch::estimate(const std::string& key) const {
+        std::uint64_t result = std::numeric_limits<std::uint64_t>::max();
+        for (std::size_t row = 0; row < kDepth; ++row) {
+            const std::size_t column = hash64(key.data(), key.size(), row + 1) % kWidth;
+            result = std::min<std::uint64_t>(result, counters_[row * kWidth + column]);
+        }
+        return result;
+    }
+
+    std::vector<std::pair<std::string, std::uint64_t>> CountMinSketch::top(std::size_t limit) const {
+        std::vector<std::pair<std::string, std::uint64_t>> result;
+        for (const auto& key : candidates_) {
+            result.emplace_back(key, estimate(key));
+        }
+        std::sort(result.begin(), result.end(), [](const auto& left, const auto& right) {
+            if (left.second != right.second) {
+                return left.second > right.second;
+            }
+            return left.first < right.first;
+        });
+        if (result.size() > limit) {
+            result.resize(limit);
+        }
+        return result;
+    }
+
+    void SketchSet::merge(const SketchSet& other) {
+        hashed_files += other.hashed_files;
+        distinct_content.merge(other.distinct_content);
+        size_bytes.merge(other.size_bytes);
+        age_days.merge(other.age_days);
+        extensions.merge(other.extensions);
+    }
+}
@@ -0,0 +1,103 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include "file_probe/small_file.hpp"
+
+namespace file_probe {
+
+    namespace {
+        int open_without_atime(int dirfd, const char* name, bool follow_links) {
+            // O_NONBLOCK keeps a FIFO from blocking the open; it does not affect
+            // reads from regular files.
+            const int flags = O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC | (follow_links ? 0 : O_NOFOLLOW);
+            int fd = openat(dirfd, name, flags | O_NOATIME);
+            if (fd < 0 && errno == EPERM) {
+                // O_NOATIME is only permitted for the file owner.
+                fd = openat(dirfd, name, flags);
+            }
+            return fd;
+        }
+    }
+
+    FileHandle::FileHandle(FileHandle&& other) noexcept : fd_(other.fd_) {
+        other.fd_ = -1;
+    }
+
+    FileHandle& FileHandle::operator=(FileHandle&& other) noexcept {
+        if (this != &other) {
+            if (fd_ >= 0) {
+                close(fd_);
+            }
+            fd_ = other.fd_;
+            other.fd_ = -1;
+        }
+        return *this;
+    }
+
+    FileHandle::~FileHandle() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    std::optional<SmallFile> open_small_file(int dirfd, const char* name, bool follow_links) {
+        SmallFile file;
+        file.fd = FileHandle(open_without_atime(dirfd, name, follow_links));
+        if (!file.fd || fstat(file.fd.get(), &file.info) != 0) {
+            return std::nullopt;
+        }
+        return file;
+    }
+
+    bool load_small_file(SmallFile& file, std::size_t limit) {
+        const auto expected = static_cast<std::size_t>(file.info.st_size);
+        if (file.loaded || !file.fd || !S_ISREG(file.info.st_mode) || expected > limit) {
+            return file.loaded;
+        }
+
+        file.buffer = acquire_read_buffer();
+        if (!file.buffer || file.buffer.size() < expected) {
+            file.buffer = ReadBuffer();
+            return false;
+        }
+
+        // Read to EOF rather than trusting st_size: pseudo-files report 0 and a
+        // file may grow after fstat. Any disagreement hands the file back to
+        // the streaming path.
+        const int fd = file.fd.get();
+        const std::size_t capacity = std::min(limit + 1, file.buffer.size());
+        std::size_t total = 0;
+        bool read_failed = false;
+        while (total < capacity) {
+            ssize_t bytes_read = read(fd, file.buffer.data() + total, capacity - total);
+            if (bytes_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_read < 0) {
+                read_failed = true;
+            }
+            if (bytes_read <= 0) {
+                break;
+            }
+            total += static_cast<std::size_t>(bytes_read);
+        }
+
+        if (read_failed || total != expected || total > limit) {
+            file.buffer = ReadBuffer();
+            return false;
+        }
+
+        file.size = total;
+        file.loaded = true;
+        return true;
+    }
+
+    std::optional<SmallFile> read_small_file(int dirfd, const char* name, std::size_t limit, bool follow_links) {
+        auto file = open_small_file(dirfd, name, follow_links);
+        if (file) {
+            load_small_file(*file, limit);
+        }
+        return file;
+    }
+}
@@ -0,0 +1,344 @@
+#include "file_probe/sqlite_inventory.hpp"
+
+#if defined(FILE_PROBE_SQLITE)
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <variant>
+#include <optional>
+#include <condition_variable>
+#include <sqlite3.h>
+#endif
+
+namespace file_probe {
+
+#if defined(FILE_PROBE_SQLITE)
+    namespace {
+        constexpr std::size_t kRowsPerTransaction = 10000;
+        constexpr std::size_t kQueueCapacity = 4096;
+
+        constexpr const char* kSchema =
+            "PRAGMA journal_mode=WAL;"
+            "PRAGMA synchronous=NORMAL;"
+            "CREATE TABLE IF NOT EXISTS runs ("
+            " id INTEGER PRIMARY KEY, root TEXT NOT NULL, created TEXT NOT NULL DEFAULT CURRENT_TIMESTAMP);"
+            "CREATE TABLE IF NOT EXISTS files ("
+            " run_id INTEGER NOT NULL REFERENCES runs(id), path TEXT NOT NULL, type TEXT NOT NULL,"
+            " size_bytes INTEGER, sha256 TEXT, permissions TEXT, owner TEXT, \"group\" TEXT,"
+            " accessed TEXT, modified TEXT, changed TEXT, symlink_target TEXT);"
+            "CREATE TABLE IF NOT EXISTS directories ("
+            " run_id INTEGER NOT NULL REFERENCES runs(id), path TEXT NOT NULL, total_size_bytes INTEGER NOT NULL,"
+            " file_count INTEGER NOT NULL, directory_count INTEGER NOT NULL, symlink_count INTEGER NOT NULL,"
+            " broken_symlink_count INTEGER NOT NULL);"
+            "CREATE TABLE IF NOT EXISTS media_streams ("
+            " run_id INTEGER NOT NULL REFERENCES runs(id), path TEXT NOT NULL, resolution TEXT,"
+            " duration TEXT, metadata TEXT);"
+            "CREATE TABLE IF NOT EXISTS warnings ("
+            " run_id INTEGER NOT NULL REFERENCES runs(id), path TEXT NOT NULL, message TEXT NOT NULL);"
+            "CREATE INDEX IF NOT EXISTS files_by_sha256 ON files(sha256);"
+            "CREATE INDEX IF NOT EXISTS files_by_path ON files(path);";
+
+        struct FileRow {
+            std::string path;
+            std::string type;
+            std::optional<std::uintmax_t> size_bytes;
+            std::optional<std::string> sha256;
+            std::optional<std::string> permissions;
+            std::optional<std::string> owner;
+            std::optional<std::string> group;
+            std::optional<std::string> accessed;
+            std::optional<std::string> modified;
+            std::optional<std::string> changed;
+            std::optional<std::string> symlink_target;
+        };
+
+        struct DirectoryRow {
+            std::string path;
+            std::uintmax_t total_size_bytes = 0;
+            std::size_t file_count = 0;
+            std::size_t directory_count = 0;
+            std::size_t symlink_count = 0;
+            std::size_t broken_symlink_count = 0;
+        };
+
+        struct MediaRow {
+            std::string path;
+            std::optional<std::string> resolution;
+            std::optional<std::string> duration;
+            std::optional<std::string> metadata;
+        };
+
+        struct WarningRow {
+            std::string path;
+            std::string message;
+        };
+
+        using Row = std::variant<FileRow, DirectoryRow, MediaRow, WarningRow>;
+
+        struct StatementDeleter {
+            void operator()(sqlite3_stmt* statement) const noexcept { sqlite3_finalize(statement); }
+        };
+
+        using Statement = std::unique_ptr<sqlite3_stmt, StatementDeleter>;
+
+        class Binder {
+        public:
+            explicit Binder(sqlite3_stmt* statement) : statement_(statement) {
+                sqlite3_reset(statement_);
+                sqlite3_clear_bindings(statement_);
+            }
+
+            Binder& text(const std::string& value) {
+                sqlite3_bind_text(statement_, ++index_, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+                return *this;
+            }
+
+            Binder& text(const std::optional<std::string>& value) {
+                return value ? text(*value) : null();
+            }
+
+            Binder& integer(std::uintmax_t value) {
+                sqlite3_bind_int64(statement_, ++index_, static_cast<sqlite3_int64>(value));
+                return *this;
+            }
+
+            Binder& integer(const std::optional<std::uintmax_t>& value) {
+                return value ? integer(*value) : null();
+            }
+
+            Binder& null() {
+                sqlite3_bind_null(statement_, ++index_);
+                return *this;
+            }
+
+            bool step() {
+                return sqlite3_step(statement_) == SQLITE_DONE;
+            }
+
+        private:
+            sqlite3_stmt* statement_;
+            int index_ = 0;
+        };
+
+        // Owns the connection on a dedicated thread; producers hand rows over
+        // through a bounded queue and never touch SQLite themselves.
+        class InventoryWriter {
+        public:
+            ~InventoryWriter() {
+                close();
+                // Statements must be finalized before the connection closes.
+                for (Statement* statement : {&insert_run_, &insert_file_, &insert_directory_, &insert_media_, &insert_warning_}) {
+                    statement->reset();
+                }
+                if (db_) {
+                    sqlite3_close(db_);
+                }
+            }
+
+            bool open(const std::string& path, const std::string& root, std::string& error) {
+                if (sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+                    error = "Cannot open " + path + ": " + sqlite3_errmsg(db_);
+                    return false;
+                }
+                sqlite3_busy_timeout(db_, 5000);
+                if (!exec(kSchema, error) || !exec("BEGIN", error)) {
+                    return false;
+                }
+                if (!prepare(insert_run_, "INSERT INTO runs(root) VALUES (?)", error) ||
+                    !prepare(insert_file_, "INSERT INTO files VALUES (?,?,?,?,?,?,?,?,?,?,?,?)", error) ||
+                    !prepare(insert_directory_, "INSERT INTO directories VALUES (?,?,?,?,?,?,?)", error) ||
+                    !prepare(insert_media_, "INSERT INTO media_streams VALUES (?,?,?,?,?)", error) ||
+                    !prepare(insert_warning_, "INSERT INTO warnings VALUES (?,?,?)", error)) {
+                    return false;
+                }
+                if (!Binder(insert_run_.get()).text(root).step()) {
+                    error = std::string("Cannot record run: ") + sqlite3_errmsg(db_);
+                    return false;
+                }
+                run_id_ = sqlite3_last_insert_rowid(db_);
+                worker_ = std::thread([this] { drain(); });
+                return true;
+            }
+
+            void push(Row row) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                space_.wait(lock, [this] { return queue_.size() < kQueueCapacity; });
+                queue_.push_back(std::move(row));
+                ready_.notify_one();
+            }
+
+            // Joins the writer and commits the last batch.
+            bool close(std::string* error = nullptr) {
+                if (worker_.joinable()) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        closing_ = true;
+                    }
+                    ready_.notify_one();
+                    worker_.join();
+                }
+                if (error && !error_.empty()) {
+                    *error = error_;
+                }
+                return error_.empty();
+            }
+
+        private:
+            bool exec(const char* sql, std::string& error) {
+                char* message = nullptr;
+                if (sqlite3_exec(db_, sql, nullptr, nullptr, &message) != SQLITE_OK) {
+                    error = std::string("SQLite error: ") + (message ? message : sqlite3_errmsg(db_));
+                    sqlite3_free(message);
+                    return false;
+                }
+                return true;
+            }
+
+            bool prepare(Statement& statement, const char* sql, std::string& error) {
+                sqlite3_stmt* raw = nullptr;
+                if (sqlite3_prepare_v3(db_, sql, -1, SQLITE_PREPARE_PERSISTENT, &raw, nullptr) != SQLITE_OK) {
+                    error = std::string("SQLite error: ") + sqlite3_errmsg(db_);
+                    return false;
+                }
+                statement.reset(raw);
+                return true;
+            }
+
+            bool insert(const FileRow& row) {
+                return Binder(insert_file_.get()).integer(run_id_).text(row.path).text(row.type).integer(row.size_bytes)
+                    .text(row.sha256).text(row.permissions).text(row.owner).text(row.group)
+                    .text(row.accessed).text(row.modified).text(row.changed).text(row.symlink_target).step();
+            }
+
+            bool insert(const DirectoryRow& row) {
+                return Binder(insert_directory_.get()).integer(run_id_).text(row.path).integer(row.total_size_bytes)
+                    .integer(row.file_count).integer(row.directory_count).integer(row.symlink_count)
+                    .integer(row.broken_symlink_count).step();
+            }
+
+            bool insert(const MediaRow& row) {
+                return Binder(insert_media_.get()).integer(run_id_).text(row.path)
+                    .text(row.resolution).text(row.duration).text(row.metadata).step();
+            }
+
+            bool insert(const WarningRow& row) {
+                return Binder(insert_warning_.get()).integer(run_id_).text(row.path).text(row.message).step();
+            }
+
+            void drain() {
+                std::size_t in_transaction = 0;
+                std::deque<Row> batch;
+                for (;;) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        ready_.wait(lock, [this] { return closing_ || !queue_.empty(); });
+                        if (queue_.empty()) {
+                            break;
+                        }
+                        batch.swap(queue_);
+                    }
+                    space_.notify_all();
+
+                    for (const Row& row : batch) {
+                        if (!error_.empty()) {
+                            continue;
+                        }
+                        if (!std::visit([this](const auto& value) { return insert(value); }, row)) {
+                            error_ = std::string("SQLite insert failed: ") + sqlite3_errmsg(db_);
+                        } else if (++in_transaction >= kRowsPerTransaction) {
+                            in_transaction = 0;
+                            exec("COMMIT; BEGIN", error_);
+                        }
+                    }
+                    batch.clear();
+                }
+                exec(error_.empty() ? "COMMIT" : "ROLLBACK", error_);
+            }
+
+            sqlite3* db_ = nullptr;
+            sqlite3_int64 run_id_ = 0;
+            Statement insert_run_;
+            Statement insert_file_;
+            Statement insert_directory_;
+            Statement insert_media_;
+            Statement insert_warning_;
+
+            std::thread worker_;
+            std::mutex mutex_;
+            std::condition_variable ready_;
+            std::condition_variable space_;
+            std::deque<Row> queue_;
+            bool closing_ = false;
+            std::string error_;
+        };
+    }
+
+    bool sqlite_inventory_available() {
+        return true;
+    }
+
+    bool write_sqlite_inventory(const std::string& path, const FileReport& report, std::string& error) {
+        const std::string root = report.absolute_path.string();
+        InventoryWriter writer;
+        if (!writer.open(path, root, error)) {
+            return false;
+        }
+
+        FileRow file;
+        file.path = root;
+        file.type = report.type;
+        if (report.file_detail) {
+            file.size_bytes = report.file_detail->size_bytes;
+            if (!report.file_detail->checksum.empty()) {
+                file.sha256 = report.file_detail->checksum;
+            }
+        }
+        file.permissions = report.permissions;
+        if (report.ownership) {
+            file.owner = report.ownership->owner;
+            file.group = report.ownership->group;
+        }
+        if (report.timestamps) {
+            file.accessed = report.timestamps->last_access;
+            file.modified = report.timestamps->last_modify;
+            file.changed = report.timestamps->last_change;
+        }
+        file.symlink_target = report.symlink.target;
+        writer.push(std::move(file));
+
+        if (const auto& detail = report.file_detail; detail && (detail->resolution || detail->duration || detail->metadata)) {
+            writer.push(MediaRow {root, detail->resolution, detail->duration, detail->metadata});
+        }
+
+        if (const auto& directory = report.directory_detail) {
+            writer.push(DirectoryRow {root, directory->total_size_bytes, directory->file_count, directory->directory_count,
+                                      directory->symlinks.symlink_count, directory->symlinks.broken_count});
+            if (directory->matches) {
+                for (const auto& match : *directory->matches) {
+                    FileRow entry;
+                    entry.path = match.path;
+                    entry.type = match.type;
+                    entry.size_bytes = match.size_bytes;
+                    writer.push(std::move(entry));
+                }
+            }
+        }
+
+        for (const auto& warning : report.warnings) {
+            writer.push(WarningRow {root, warning});
+        }
+
+        return writer.close(&error);
+    }
+#else
+    bool sqlite_inventory_available() {
+        return false;
+    }
+
+    bool write_sqlite_inventory(const std::string&, const FileReport&, std::string& error) {
+        error = "SQLite output is not available in this build (rebuild with make SQLITE=1)";
+        return false;
+    }
+#endif
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "file_probe/table.hpp"
+
+namespace file_probe {
+
+    namespace {
+        constexpr const char* kColorReset = "\033[0m";
+
+        // Display width of UTF-8 text, counting code points rather than bytes.
+        std::size_t display_width(const std::string& text) {
+            return static_cast<std::size_t>(std::count_if(text.begin(), text.end(), [](char c) {
+                return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+            }));
+        }
+    }
+
+    TableWriter::TableWriter(OutputBuffer& out, std::vector<TableColumn> columns, bool fixed_widths)
+        : out_(out), columns_(std::move(columns)), widths_(columns_.size(), 0), fixed_widths_(fixed_widths) {
+        for (std::size_t index = 0; index < columns_.size(); ++index) {
+            widths_[index] = fixed_widths_ ? columns_[index].fixed_width : 0;
+        }
+    }
+
+    TableWriter::~TableWriter() {
+        finish();
+    }
+
+    void TableWriter::add_row(std::vector<std::string> cells, const char* color) {
+        cells.resize(columns_.size());
+        Row row {std::move(cells), color};
+        if (fixed_widths_) {
+            write_row(row);
+            return;
+        }
+        pending_.push_back(std::move(row));
+        if (pending_.size() >= kLookahead) {
+            drain();
+        }
+    }
+
+    void TableWriter::finish() {
+        drain();
+    }
+
+    void TableWriter::drain() {
+        for (const Row& row : pending_) {
+            for (std::size_t index = 0; index < columns_.size(); ++index) {
+                widths_[index] = std::max(widths_[index], display_width(row.cells[index]));
+            }
+        }
+        for (const Row& row : pending_) {
+            write_row(row);
+        }
+        pending_.clear();
+    }
+
+    void TableWriter::write_row(const Row& row) {
+        const std::size_t last = columns_.size() - 1;
+        for (std::size_t index = 0; index <= last; ++index) {
+            const std::string& cell = row.cells[index];
+            const std::size_t width = display_width(cell);
+            const std::size_t padding = widths_[index] > width ? widths_[index] - width : 0;
+            if (index > 0) {
+                out_.append(' ');
+            }
+            if (columns_[index].right_align) {
+                out_.append_padding(' ', padding);
+            }
+            // Only the final column is coloured, so padding never sits inside
+            // an escape sequence.
+            if (row.color && index == last) {
+                out_.append(row.color);
+                out_.append(cell);
+                out_.append(kColorReset);
+            } else {
+                out_.append(cell);
+            }
+            if (!columns_[index].right_align && index < last) {
+                out_.append_padding(' ', padding);
+            }
+        }
+        out_.append('\n');
+    }
+}
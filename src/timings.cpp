@@ -0,0 +1,77 @@
+#include <utility>
+#include "file_probe/timings.hpp"
+
+namespace file_probe {
+
+    namespace {
+        thread_local PhaseRecorder* current_recorder = nullptr;
+        // kPhaseCount when no phase is open.
+        thread_local std::size_t current_phase = kPhaseCount;
+
+        constexpr std::array<const char*, kPhaseCount> kPhaseNames = {
+            "metadata", "classify", "hash", "media", "walk", "render"};
+    }
+
+    const char* phase_name(Phase phase) {
+        return kPhaseNames[static_cast<std::size_t>(phase)];
+    }
+
+    void PhaseRecorder::add(Phase phase, std::chrono::nanoseconds elapsed) {
+        elapsed_[static_cast<std::size_t>(phase)] += elapsed;
+    }
+
+    std::chrono::nanoseconds PhaseRecorder::elapsed(Phase phase) const {
+        return elapsed_[static_cast<std::size_t>(phase)];
+    }
+
+    void PhaseRecorder::set_read_profile(ReadProfile profile) {
+        read_profile_ = std::move(profile);
+    }
+
+    void PhaseRecorder::add_counters(Phase phase, const PerfSample& start, const PerfSample& end) {
+        PerfSample& total = counters_[static_cast<std::size_t>(phase)];
+        for (std::size_t index = 0; index < kPerfEventCount; ++index) {
+            total[index] += end[index] - start[index];
+        }
+    }
+
+    const PerfSample& PhaseRecorder::counters(Phase phase) const {
+        return counters_[static_cast<std::size_t>(phase)];
+    }
+
+    void install_phase_recorder(PhaseRecorder* recorder) {
+        current_recorder = recorder;
+    }
+
+    PhaseRecorder* active_phase_recorder() {
+        return current_recorder;
+    }
+
+    std::optional<Phase> innermost_phase() {
+        if (current_phase == kPhaseCount) {
+            return std::nullopt;
+        }
+        return static_cast<Phase>(current_phase);
+    }
+
+    ScopedPhase::ScopedPhase(Phase phase) : phase_(phase), outer_phase_(current_phase), recorder_(current_recorder) {
+        current_phase = static_cast<std::size_t>(phase);
+        if (recorder_) {
+            if (const PerfCounters* counters = recorder_->perf_counters()) {
+                start_counters_ = counters->read();
+            }
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedPhase::~ScopedPhase() {
+        current_phase = outer_phase_;
+        if (recorder_) {
+            recorder_->add(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_));
+            if (const PerfCounters* counters = recorder_->perf_counters()) {
+                recorder_->add_counters(phase_, start_counters_, counters->read());
+            }
+        }
+    }
+}
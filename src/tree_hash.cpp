@@ -0,0 +1,190 @@
+#include <atomic>
+#include <future>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/stat.h>
+#include "file_probe/hash.hpp"
+#include "file_probe/utils.hpp"
+#include "file_probe/timings.hpp"
+#include "file_probe/binary_io.hpp"
+#include "file_probe/tree_hash.hpp"
+
+namespace file_probe {
+
+    namespace {
+        using Path = std::filesystem::path;
+
+        constexpr std::string_view kDomain = "file-probe tree v1";
+
+        struct DirectoryResult {
+            Sha256Digest digest {};
+            std::vector<std::pair<std::string, Sha256Digest>> subdirectories;
+            std::vector<std::string> warnings;
+            size_t unreadable = 0;
+            uintmax_t size_bytes = 0;
+            size_t file_count = 0;
+            size_t directory_count = 0;
+            size_t symlink_count = 0;
+        };
+
+        struct Entry {
+            std::string name;
+            struct stat info {};
+        };
+
+        class TreeHasher {
+        public:
+            TreeHasher() : spare_workers_(static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) - 1) {}
+
+            DirectoryResult hash_directory(const Path& path) {
+                DirectoryResult result;
+                std::vector<Entry> entries;
+                if (!list_directory(path, entries, result)) {
+                    result.warnings.push_back("Tree hash: unable to read directory " + path.string() + ": " +
+                                              std::strerror(errno));
+                    ++result.unreadable;
+                }
+                std::sort(entries.begin(), entries.end(),
+                          [](const Entry& left, const Entry& right) { return left.name < right.name; });
+
+                // Subtrees start first so they overlap with hashing this
+                // directory's files; unclaimed ones run inline afterwards.
+                std::vector<std::future<DirectoryResult>> pending(entries.size());
+                for (std::size_t index = 0; index < entries.size(); ++index) {
+                    if (S_ISDIR(entries[index].info.st_mode) && claim_worker()) {
+                        try {
+                            pending[index] = std::async(std::launch::async, [this, child = path / entries[index].name] {
+                                DirectoryResult child_result = hash_directory(child);
+                                spare_workers_.fetch_add(1);
+                                return child_result;
+                            });
+                        } catch (const std::system_error&) {
+                            // No thread to be had; the subtree is hashed inline below.
+                            spare_workers_.fetch_add(1);
+                        }
+                    }
+                }
+
+                BinaryWriter records;
+                records.put_bytes(kDomain.data(), kDomain.size());
+                for (std::size_t index = 0; index < entries.size(); ++index) {
+                    const Entry& entry = entries[index];
+                    const mode_t mode = entry.info.st_mode;
+                    std::uint64_t size = 0;
+                    Sha256Digest digest {};
+
+                    if (S_ISDIR(mode)) {
+                        DirectoryResult child = pending[index].valid() ? pending[index].get()
+                                                                       : hash_directory(path / entry.name);
+                        digest = child.digest;
+                        result.subdirectories.emplace_back(entry.name, child.digest);
+                        result.warnings.insert(result.warnings.end(), child.warnings.begin(), child.warnings.end());
+                        result.unreadable += child.unreadable;
+                        result.size_bytes += child.size_bytes;
+                        result.file_count += child.file_count;
+                        result.directory_count += child.directory_count + 1;
+                        result.symlink_count += child.symlink_count;
+                    } else if (S_ISREG(mode)) {
+                        size = static_cast<std::uint64_t>(entry.info.st_size);
+                        result.size_bytes += size;
+                        ++result.file_count;
+                        if (auto content = compute_sha256_digest(path / entry.name)) {
+                            digest = *content;
+                        } else {
+                            result.warnings.push_back("Tree hash: unable to read " + (path / entry.name).string());
+                            ++result.unreadable;
+                        }
+                    } else if (S_ISLNK(mode)) {
+                        ++result.symlink_count;
+                        std::string target(static_cast<std::size_t>(std::max<off_t>(entry.info.st_size, 0)) + 1, '\0');
+                        const ssize_t length = readlink((path / entry.name).c_str(), target.data(), target.size());
+                        if (length >= 0) {
+                            target.resize(static_cast<std::size_t>(length));
+                            size = target.size();
+                            Sha256 hasher;
+                            hasher.update(reinterpret_cast<const std::uint8_t*>(target.data()), target.size());
+                            digest = hasher.finalize();
+                        } else {
+                            result.warnings.push_back("Tree hash: unable to read link " + (path / entry.name).string());
+                            ++result.unreadable;
+                        }
+                    }
+
+                    records.put_string(entry.name);
+                    records.put_u32(static_cast<std::uint32_t>(mode & (S_IFMT | 07777)));
+                    records.put_u64(size);
+                    records.put_bytes(digest.data(), digest.size());
+                }
+
+                Sha256 hasher;
+                hasher.update(reinterpret_cast<const std::uint8_t*>(records.data().data()), records.data().size());
+                result.digest = hasher.finalize();
+                return result;
+            }
+
+        private:
+            bool claim_worker() {
+                int available = spare_workers_.load();
+                while (available > 0) {
+                    if (spare_workers_.compare_exchange_weak(available, available - 1)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            static bool list_directory(const Path& path, std::vector<Entry>& entries, DirectoryResult& result) {
+                DIR* directory = opendir(path.c_str());
+                if (!directory) {
+                    return false;
+                }
+                const int fd = dirfd(directory);
+                while (const dirent* item = readdir(directory)) {
+                    if (std::strcmp(item->d_name, ".") == 0 || std::strcmp(item->d_name, "..") == 0) {
+                        continue;
+                    }
+                    Entry entry;
+                    entry.name = item->d_name;
+                    if (fstatat(fd, item->d_name, &entry.info, AT_SYMLINK_NOFOLLOW) != 0) {
+                        result.warnings.push_back("Tree hash: unable to stat " + (path / entry.name).string());
+                        ++result.unreadable;
+                        continue;
+                    }
+                    entries.push_back(std::move(entry));
+                }
+                closedir(directory);
+                return true;
+            }
+
+            std::atomic<int> spare_workers_;
+        };
+    }
+
+    DirectoryDetail collect_tree_hash_detail(const Path& root, std::vector<std::string>& warnings) {
+        ScopedPhase phase(Phase::Hash);
+        TreeHasher hasher;
+        DirectoryResult result = hasher.hash_directory(root);
+
+        DirectoryDetail detail;
+        detail.total_size_bytes = result.size_bytes;
+        detail.total_size_human = format_size(result.size_bytes);
+        detail.file_count = result.file_count;
+        detail.directory_count = result.directory_count;
+        detail.symlinks.symlink_count = result.symlink_count;
+
+        TreeHash& tree = detail.tree_hash.emplace();
+        tree.digest = to_hex(result.digest);
+        for (const auto& [name, digest] : result.subdirectories) {
+            tree.children.emplace_back(name, to_hex(digest));
+        }
+        tree.unreadable_entries = result.unreadable;
+        warnings.insert(warnings.end(), result.warnings.begin(), result.warnings.end());
+        return detail;
+    }
+}
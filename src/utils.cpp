@@ -1,8 +1,10 @@
 #include <ctime>
+#include <array>
 #include <cctype>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <unistd.h>
 #include <algorithm>
 #include "file_probe/utils.hpp"
 
@@ -38,6 +40,9 @@ namespace file_probe {
         if ((perms & std::filesystem::perms::others_read) != std::filesystem::perms::none) symbols[6] = 'r';
         if ((perms & std::filesystem::perms::others_write) != std::filesystem::perms::none) symbols[7] = 'w';
         if ((perms & std::filesystem::perms::others_exec) != std::filesystem::perms::none) symbols[8] = 'x';
+        if ((perms & std::filesystem::perms::set_uid) != std::filesystem::perms::none) symbols[2] = symbols[2] == 'x' ? 's' : 'S';
+        if ((perms & std::filesystem::perms::set_gid) != std::filesystem::perms::none) symbols[5] = symbols[5] == 'x' ? 's' : 'S';
+        if ((perms & std::filesystem::perms::sticky_bit) != std::filesystem::perms::none) symbols[8] = symbols[8] == 'x' ? 't' : 'T';
         return symbols;
     }
 
@@ -58,21 +63,31 @@ namespace file_probe {
             return false;
         }
 
-        char ch = 0;
-        std::size_t samples = 0;
-        std::size_t non_text = 0;
-        while (file.get(ch) && samples < kTextProbeLength) {
-            unsigned char byte = static_cast<unsigned char>(ch);
-            if (!std::isprint(byte) && !std::isspace(byte)) {
-                ++non_text;
-            }
-            ++samples;
-        }
+        std::array<char, kTextProbeLength> sample {};
+        file.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+        return is_text_buffer(reinterpret_cast<const std::uint8_t*>(sample.data()),
+                            static_cast<std::size_t>(file.gcount()));
+    }
+
+    bool is_text_file(int fd) {
+        std::array<std::uint8_t, kTextProbeLength> sample {};
+        const ssize_t length = pread(fd, sample.data(), sample.size(), 0);
+        return length >= 0 && is_text_buffer(sample.data(), static_cast<std::size_t>(length));
+    }
 
+    bool is_text_buffer(const std::uint8_t* data, std::size_t length) {
+        const std::size_t samples = std::min(length, kTextProbeLength);
         if (samples == 0) {
             return true;
         }
 
+        std::size_t non_text = 0;
+        for (std::size_t index = 0; index < samples; ++index) {
+            if (!std::isprint(data[index]) && !std::isspace(data[index])) {
+                ++non_text;
+            }
+        }
+
         return static_cast<double>(non_text) / static_cast<double>(samples) < 0.3;
     }
 